@@ -5,14 +5,22 @@
 #define CENTRALIZED 1
 #define RING 2
 #define GOSSIP 3
+#define HIERARCHICAL 23
+#define SHARDED 24
+#define BIRING 25
+#define DIGESTGOSSIP 26
 
 #define BASICSIG 4
 #define MULTISIG 5
 #define AGGREGATESIG 6
 #define THRESHOLDSIG 7
+#define POPMULTISIG 15
+#define MOCKSIG 27
 
 #define LAZY 8
 #define EAGER 9
+#define BACKGROUND 21
+#define ADAPTIVE 22
 
 #define INFOSMERGE 10
 #define PKAGG 11
@@ -21,11 +29,27 @@
 #define BYMSG 13
 #define BATCH 14
 
+#define INPROCESS 16
+#define SOCKETS 17
+#define SHAREDMEM 18
+#define SHAREDMEMPOLL 19
+#define ASYNC 20
+
 int t;
 int patt;
 int scm;
 int eval;
 int agg;
 int ver;
+int workers;
+int mode;
+int port;
+int threads;
+int presign;
+int instances;
+int instance;
+int switching;
+int bandwidth;
+int counting;
 
 #endif
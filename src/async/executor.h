@@ -0,0 +1,116 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <bls.hpp>
+
+// fire-and-forget coroutine: starts right away and frees itself when it returns
+class detached {
+public:
+    class promise_type {
+    public:
+        detached get_return_object() {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+// fixed pool of threads resuming coroutines in the order they were scheduled
+class executor {
+public:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<std::coroutine_handle<>> queue;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    explicit executor(int size) {
+        for (int k = 0; k < size; k++) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~executor() {
+        join();
+    }
+
+    void post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            queue.push_back(handle);
+        }
+        ready.notify_one();
+    }
+
+    void work() {
+        bls::BLS::Init(); // relic's context is per thread (built with -DMULTI=PTHREAD)
+        while (true) {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            std::coroutine_handle<> handle = queue.front();
+            queue.pop_front();
+            guard.unlock();
+            handle.resume();
+        }
+    }
+
+    // runs what is still queued, then stops the threads
+    void join() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread &thread : threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    class schedule_awaiter {
+    public:
+        executor &pool;
+
+        bool await_ready() {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            pool.post(handle);
+        }
+
+        void await_resume() {}
+    };
+
+    // co_await pool.schedule() continues on one of the pool's threads
+    schedule_awaiter schedule() {
+        return {*this};
+    }
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <coroutine>
+#include <deque>
+#include <mutex>
+
+#include "../message.h"
+#include "executor.h"
+
+// inbox of one replica coroutine: any thread delivers, the single consumer co_awaits receive() and is
+// resumed on the executor when a message arrives; receive() yields nullptr once closed and drained
+class mailbox {
+public:
+    executor &pool;
+    std::mutex lock;
+    std::deque<message_ptr> queue;
+    std::coroutine_handle<> waiting;
+    bool closed = false;
+
+    explicit mailbox(executor &pool) : pool(pool) {}
+
+    void deliver(message_ptr msg) {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            queue.push_back(std::move(msg));
+            std::swap(handle, waiting);
+        }
+        if (handle) {
+            pool.post(handle);
+        }
+    }
+
+    void close() {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+            std::swap(handle, waiting);
+        }
+        if (handle) {
+            pool.post(handle);
+        }
+    }
+
+    class receive_awaiter {
+    public:
+        mailbox &box;
+
+        bool await_ready() {
+            std::lock_guard<std::mutex> guard(box.lock);
+            return !box.queue.empty() || box.closed;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> guard(box.lock);
+            if (!box.queue.empty() || box.closed) {
+                return false;
+            }
+            box.waiting = handle;
+            return true;
+        }
+
+        message_ptr await_resume() {
+            std::lock_guard<std::mutex> guard(box.lock);
+            if (box.queue.empty()) {
+                return nullptr;
+            }
+            message_ptr msg = std::move(box.queue.front());
+            box.queue.pop_front();
+            return msg;
+        }
+    };
+
+    receive_awaiter receive() {
+        return {*this};
+    }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <bls.hpp>
+
+#include "../arguments.h"
+
+// one long-lived thread running posted jobs in order
+class worker {
+public:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::thread thread;
+
+    worker() : thread([this] { work(); }) {}
+
+    ~worker() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        ready.notify_all();
+        thread.join();
+    }
+
+    void post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(std::move(job));
+        }
+        ready.notify_one();
+    }
+
+    void work() {
+        bls::BLS::Init(); // relic's context is per thread (built with -DMULTI=PTHREAD)
+        while (true) {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            guard.unlock();
+            job();
+        }
+    }
+};
+
+// shared by all the replicas of the process, started on first use
+worker & aggregation_worker() {
+    static worker aggregation;
+    return aggregation;
+}
+
+// long-lived threads helping the calling thread through data-parallel jobs
+class worker_pool {
+public:
+    std::vector<std::unique_ptr<worker>> workers;
+
+    explicit worker_pool(int size) {
+        for (int k = 0; k < size; k++) {
+            workers.push_back(std::make_unique<worker>());
+        }
+    }
+
+    // job(begin, end) over chunks of [0, count), the first one run by the caller; returns once all are done
+    void parallel_for(size_t count, const std::function<void(size_t, size_t)> &job) {
+        size_t threads = std::min(workers.size() + 1, count);
+        if (threads <= 1) {
+            job(0, count);
+            return;
+        }
+        size_t chunk = (count + threads - 1) / threads;
+        size_t chunks = (count + chunk - 1) / chunk;
+        std::latch done((std::ptrdiff_t) chunks - 1);
+        for (size_t c = 1; c < chunks; c++) {
+            size_t begin = c * chunk;
+            size_t end = std::min(begin + chunk, count);
+            workers.at(c - 1)->post([&job, &done, begin, end] {
+                job(begin, end);
+                done.count_down();
+            });
+        }
+        job(0, chunk);
+        done.wait();
+    }
+};
+
+// ::workers threads in all counting the caller, shared by all the replicas of the process, started on first use
+worker_pool & helper_pool() {
+    static worker_pool helpers(std::max(::workers, 1) - 1);
+    return helpers;
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <aggregationinfo.hpp>
+#include <bls.hpp>
+#include <privatekey.hpp>
+#include <publickey.hpp>
+#include <signature.hpp>
+#include <threshold.hpp>
+#include <test-utils.hpp>
+
+// ns per call and heap allocations per call of the bls calls the schemes make, for signer sets of the
+// sizes of the simulated clusters; -c=<file> also writes the costs of the mock scheme (-sX)
+
+// c++ allocations only, relic allocates its own points on the stack or through malloc
+std::atomic<long> allocations = 0;
+
+void * operator new(size_t size) {
+    allocations++;
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+class measurement {
+public:
+    double ns;
+    double allocs;
+};
+
+// repeated until it ran for at least MIN_NANOS (and MIN_CALLS times), after one warm-up call
+template <class F>
+measurement measure(F op) {
+    static const long MIN_NANOS = 200000000;
+    static const int MIN_CALLS = 3;
+
+    op();
+    long calls = 0;
+    long before = allocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long elapsed = 0;
+    while (elapsed < MIN_NANOS || calls < MIN_CALLS) {
+        op();
+        calls++;
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    return {(double) elapsed / calls, (double) (allocations - before) / calls};
+}
+
+void report(const std::string &operation, int n, measurement m) {
+    std::cout << operation << "," << n << "," << m.ns << "," << m.allocs << std::endl;
+}
+
+bls::PrivateKey generate_privatekey() {
+    uint8_t seed[32];
+    getRandomSeed(seed);
+    return bls::PrivateKey::FromSeed(seed, sizeof(seed));
+}
+
+int main(int argc, const char* argv[]) {
+    std::vector<int> sizes = {4, 16, 64, 256, 1000};
+    std::string costs_path;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            switch (argv[i][1]) {
+                case 'n': {
+                    // argv[i][2] == '='
+                    // comma-separated signer counts
+                    sizes.clear();
+                    std::stringstream list(argv[i] + 3);
+                    std::string size;
+                    while (std::getline(list, size, ',')) {
+                        sizes.push_back(std::max(std::stoi(size), 2));
+                    }
+                    break;
+                }
+                case 'c':
+                    // argv[i][2] == '='
+                    // cost model of the mock scheme, "<operation> <ns>" lines
+                    costs_path = argv[i] + 3;
+                    break;
+            }
+        }
+    }
+    if (sizes.empty()) {
+        return 1;
+    }
+
+    bls::BLS::Init();
+
+    uint8_t msg[1] = {1}; // the prepare message
+    uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
+    bls::Util::Hash256(hash, msg, sizeof(msg));
+
+    bls::PrivateKey sk = generate_privatekey();
+    bls::PublicKey pk = sk.GetPublicKey();
+    bls::Signature sig = sk.Sign(msg, sizeof(msg));
+    bls::InsecureSignature insec_sig = sk.SignInsecure(msg, sizeof(msg));
+    uint8_t ser_sig[bls::Signature::SIGNATURE_SIZE];
+    sig.Serialize(ser_sig);
+    uint8_t ser_pk[bls::PublicKey::PUBLIC_KEY_SIZE];
+    pk.Serialize(ser_pk);
+
+    // operation, n, ns/op, allocs/op
+    measurement sign = measure([&]() { sk.Sign(msg, sizeof(msg)); });
+    report("Sign", 1, sign);
+    measurement sign_insecure = measure([&]() { sk.SignInsecure(msg, sizeof(msg)); });
+    report("SignInsecure", 1, sign_insecure);
+    measurement verify_insecure = measure([&]() { insec_sig.Verify({hash}, {pk}); });
+    report("InsecureSignature::Verify", 1, verify_insecure);
+    report("Signature::Verify", 1, measure([&]() { sig.Verify(); }));
+    measurement from_bytes = measure([&]() { bls::InsecureSignature::FromBytes(ser_sig); });
+    report("InsecureSignature::FromBytes", 1, from_bytes);
+    report("Signature::FromBytes", 1, measure([&]() { bls::Signature::FromBytes(ser_sig); }));
+    report("PublicKey::FromBytes", 1, measure([&]() { bls::PublicKey::FromBytes(ser_pk); }));
+    measurement serialize = measure([&]() { insec_sig.Serialize(ser_sig); });
+    report("InsecureSignature::Serialize", 1, serialize);
+    report("Signature::Serialize", 1, measure([&]() { sig.Serialize(ser_sig); }));
+
+    measurement aggregate {};
+    measurement keyagg {};
+    int largest = 0;
+    for (int n : sizes) {
+        std::vector<bls::PrivateKey> sks;
+        std::vector<bls::PublicKey> pks;
+        std::vector<bls::Signature> sigs;
+        std::vector<bls::InsecureSignature> insec_sigs;
+        std::vector<bls::AggregationInfo> infos;
+        for (int i = 0; i < n; i++) {
+            sks.push_back(generate_privatekey());
+            pks.push_back(sks.at(i).GetPublicKey());
+            sigs.push_back(sks.at(i).Sign(msg, sizeof(msg)));
+            insec_sigs.push_back(sks.at(i).SignInsecure(msg, sizeof(msg)));
+            infos.push_back(bls::AggregationInfo::FromMsgHash(pks.at(i), hash));
+        }
+
+        report("Signature::Aggregate", n, measure([&]() { bls::Signature::Aggregate(sigs); }));
+        bls::Signature multisig = bls::Signature::Aggregate(sigs);
+        report("Signature::Verify", n, measure([&]() { multisig.Verify(); }));
+        report("AggregationInfo::MergeInfos", n, measure([&]() { bls::AggregationInfo::MergeInfos(infos); }));
+        report("PublicKey::Aggregate", n, measure([&]() { bls::PublicKey::Aggregate(pks); }));
+        measurement pks_insecure = measure([&]() { bls::PublicKey::AggregateInsecure(pks); });
+        report("PublicKey::AggregateInsecure", n, pks_insecure);
+        measurement sigs_insecure = measure([&]() { bls::InsecureSignature::Aggregate(insec_sigs); });
+        report("InsecureSignature::Aggregate", n, sigs_insecure);
+
+        // shares of a 2t+1 out of n key, dealt by one player instead of the whole dkg
+        int k = 2*((n - 1) / 3) + 1;
+        std::vector<bls::PublicKey> commits;
+        std::vector<bls::PrivateKey> frags;
+        for (int i = 0; i < n; i++) {
+            if (i < k) {
+                commits.push_back(pk);
+            }
+            frags.push_back(sk);
+        }
+        bls::Threshold::Create(commits, frags, k, n);
+        std::vector<bls::InsecureSignature> shares;
+        std::vector<size_t> players;
+        for (int i = 0; i < k; i++) {
+            shares.push_back(frags.at(i).SignInsecure(msg, sizeof(msg)));
+            players.push_back(i + 1);
+        }
+        report("Threshold::AggregateUnitSigs", n, measure([&]() { bls::Threshold::AggregateUnitSigs(shares, msg, sizeof(msg), players.data(), k); }));
+
+        if (n > largest) {
+            largest = n;
+            aggregate = {sigs_insecure.ns / (n - 1), sigs_insecure.allocs};
+            keyagg = {pks_insecure.ns / (n - 1), pks_insecure.allocs};
+        }
+    }
+
+    if (!costs_path.empty()) {
+        // per operation of the proof-of-possession scheme the mock stands for, see cost_model.h
+        std::ofstream costs(costs_path);
+        costs << "sign " << (long) sign_insecure.ns << std::endl;
+        costs << "decompress " << (long) from_bytes.ns << std::endl;
+        costs << "pairing " << (long) (verify_insecure.ns / 2) << std::endl;
+        costs << "aggregate " << (long) aggregate.ns << std::endl;
+        costs << "keyagg " << (long) keyagg.ns << std::endl;
+        costs << "serialize " << (long) serialize.ns << std::endl;
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class bitmap {
+public:
+    std::vector<uint64_t> words;
+
+    bitmap() = default;
+
+    explicit bitmap(int n) : words((n + 63) / 64, 0) {}
+
+    void set(int i) {
+        if (i / 64 >= (int) words.size()) {
+            words.resize(i / 64 + 1, 0);
+        }
+        words[i / 64] |= (uint64_t) 1 << (i % 64);
+    }
+
+    bool test(int i) const {
+        return i / 64 < (int) words.size() && (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    int count() const {
+        int count = 0;
+        for (uint64_t word : words) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+    bool empty() const {
+        for (uint64_t word : words) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void merge(const bitmap &other) {
+        if (other.words.size() > words.size()) {
+            words.resize(other.words.size(), 0);
+        }
+        for (size_t w = 0; w < other.words.size(); w++) {
+            words[w] |= other.words[w];
+        }
+    }
+
+    bool contains_all(const bitmap &other) const {
+        for (size_t w = 0; w < other.words.size(); w++) {
+            uint64_t word = w < words.size() ? words[w] : 0;
+            if ((other.words[w] & ~word) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool intersects(const bitmap &other) const {
+        for (size_t w = 0; w < words.size() && w < other.words.size(); w++) {
+            if ((words[w] & other.words[w]) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // members of this bitmap that are not in other
+    std::vector<int> minus(const bitmap &other) const {
+        std::vector<int> members;
+        for (size_t w = 0; w < words.size(); w++) {
+            uint64_t word = words[w] & ~(w < other.words.size() ? other.words[w] : 0);
+            while (word != 0) {
+                int b = __builtin_ctzll(word);
+                members.push_back((int) (w * 64 + b));
+                word &= word - 1;
+            }
+        }
+        return members;
+    }
+
+    std::vector<int> members() const {
+        return minus(bitmap());
+    }
+
+    bool operator==(const bitmap &other) const {
+        return contains_all(other) && other.contains_all(*this);
+    }
+
+    bool operator<(const bitmap &other) const {
+        size_t size = std::max(words.size(), other.words.size());
+        for (size_t w = size; w-- > 0;) {
+            uint64_t a = w < words.size() ? words[w] : 0;
+            uint64_t b = w < other.words.size() ? other.words[w] : 0;
+            if (a != b) {
+                return a < b;
+            }
+        }
+        return false;
+    }
+
+    // wire size for a cluster of n replicas
+    static int length(int n) {
+        return (n + 7) / 8;
+    }
+};
+
+#endif
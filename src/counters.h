@@ -0,0 +1,174 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "arguments.h"
+
+#define HARDWARE_EVENTS 4
+
+using event_counts = std::array<uint64_t, HARDWARE_EVENTS>;
+
+// cycles, instructions, cache and branch misses of the calling thread (user space only), read as one group;
+// opened on first use and again after a fork, an inherited group would still count the parent's thread
+class hardware_counters {
+public:
+    static constexpr uint64_t CONFIGS[HARDWARE_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    int leader = -1;
+    std::array<int, HARDWARE_EVENTS> fds {-1, -1, -1, -1};
+    pid_t owner = 0;
+    bool failed = false;
+
+    ~hardware_counters() {
+        close();
+    }
+
+    void close() {
+        for (int &fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            fd = -1;
+        }
+        leader = -1;
+    }
+
+    bool open() {
+        if (owner == getpid()) {
+            return !failed;
+        }
+        close();
+        owner = getpid();
+        failed = false;
+        for (int e = 0; e < HARDWARE_EVENTS; e++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = CONFIGS[e];
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.disabled = leader < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[e] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fds[e] < 0) {
+                warn();
+                close();
+                failed = true;
+                return false;
+            }
+            if (leader < 0) {
+                leader = fds[e];
+            }
+        }
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+
+    static void warn() {
+        static std::atomic<bool> warned = false;
+        if (!warned.exchange(true)) {
+            std::cerr << "hardware counters unavailable (perf_event_paranoid or no pmu): " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    // zeros if unavailable
+    event_counts read() {
+        event_counts counts {};
+        if (!open()) {
+            return counts;
+        }
+        uint64_t values[1 + HARDWARE_EVENTS];
+        if (::read(leader, values, sizeof(values)) == (ssize_t) sizeof(values) && values[0] == HARDWARE_EVENTS) {
+            std::copy(values + 1, values + 1 + HARDWARE_EVENTS, counts.begin());
+        }
+        return counts;
+    }
+};
+
+thread_local hardware_counters thread_counters;
+
+// per replica and protocol phase, for the instance being run (-H)
+class phase_counters {
+public:
+    enum phase { PREPREPARE, PREPARE, COMMIT, PHASES };
+    static constexpr const char *PHASE_NAMES[PHASES] = {"pre-prepare", "prepare", "commit"};
+
+    int instance = 0;
+    std::vector<std::array<event_counts, PHASES>> counts;
+    std::mutex lock; // replicas of -mA step on the pool threads
+
+    void begin(int k, int n) {
+        std::lock_guard<std::mutex> guard(lock);
+        instance = k;
+        counts.assign(n, {});
+    }
+
+    void add(int replica, int phase, const event_counts &before, const event_counts &after) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (replica >= (int) counts.size()) {
+            counts.resize(replica + 1, {});
+        }
+        for (int e = 0; e < HARDWARE_EVENTS; e++) {
+            counts.at(replica).at(phase).at(e) += after.at(e) - before.at(e);
+        }
+    }
+
+    // counters,<instance>,<replica>,<phase>,<cycles>,<instructions>,<cache misses>,<branch misses>, for the
+    // replicas that ran in this process
+    void report() {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int i = 0; i < (int) counts.size(); i++) {
+            for (int p = 0; p < PHASES; p++) {
+                const event_counts &c = counts.at(i).at(p);
+                if (c == event_counts {}) {
+                    continue;
+                }
+                std::cerr << "counters," << instance << "," << i << "," << PHASE_NAMES[p];
+                for (uint64_t value : c) {
+                    std::cerr << "," << value;
+                }
+                std::cerr << std::endl;
+            }
+        }
+    }
+};
+
+phase_counters counters;
+
+// counts one step of a replica towards the phase it was in when the step began
+class counted {
+public:
+    int replica;
+    int phase;
+    bool on;
+    event_counts before {};
+
+    counted(int replica, int phase) : replica(replica), phase(phase), on(::counting) {
+        if (on) {
+            before = thread_counters.read();
+        }
+    }
+
+    ~counted() {
+        if (on) {
+            ::counters.add(replica, phase, before, thread_counters.read());
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include "arguments.h"
+#include "bitmap.h"
+
+// signers a replica knows of: what push-pull gossip (-pP) stamps on each message and keeps per peer
+class digest {
+public:
+    bitmap prepares;
+    bitmap commits;
+
+    template <class SIGS>
+    static digest of(SIGS *sigs) {
+        int n = 3*::t + 1;
+        digest d {bitmap(n), bitmap(n)};
+        for (int i = 0; i < n; i++) {
+            if (sigs->contains_prepare(i)) {
+                d.prepares.set(i);
+            }
+            if (sigs->contains_commit(i)) {
+                d.commits.set(i);
+            }
+        }
+        return d;
+    }
+
+    bool covers(const digest &other) const {
+        return prepares.contains_all(other.prepares) && commits.contains_all(other.commits);
+    }
+
+    void merge(const digest &other) {
+        prepares.merge(other.prepares);
+        commits.merge(other.commits);
+    }
+
+    // of a replica that has the commit certificate
+    bool committed() const {
+        return commits.count() >= 2*::t + 1;
+    }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef GROUPS_H
+#define GROUPS_H
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "arguments.h"
+
+// group (region) of each replica, see read_groups
+std::vector<int> groups;
+
+// k groups of consecutive replicas, or one group id per replica read from a file
+std::vector<int> read_groups(const std::string &spec, int n) {
+    std::vector<int> ids;
+    if (!spec.empty() && std::all_of(spec.begin(), spec.end(), ::isdigit)) {
+        int k = std::max(1, std::min(std::stoi(spec), n));
+        for (int i = 0; i < n; i++) {
+            ids.push_back(i * k / n);
+        }
+        return ids;
+    }
+    std::ifstream file(spec);
+    int id;
+    while ((int) ids.size() < n && file >> id) {
+        ids.push_back(id);
+    }
+    ids.resize(n, 0); // replicas missing from the file join the leader's group
+    return ids;
+}
+
+int group_of(int i) {
+    return i < (int) ::groups.size() ? ::groups.at(i) : 0;
+}
+
+// the lowest replica of the group, so the leader heads its own
+int head_of(int i) {
+    int group = group_of(i);
+    int head = 0;
+    while (group_of(head) != group) {
+        head++;
+    }
+    return head;
+}
+
+#endif
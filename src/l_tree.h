@@ -21,7 +21,7 @@ public:
         }
     }*/
 
-    bool is_leaf() {
+    bool is_leaf() const {
         return value.has_value();
     }
 };
@@ -0,0 +1,206 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "async/executor.h"
+#include "counters.h"
+#include "async/mailbox.h"
+#include "information.h"
+#include "message.h"
+#include "progress.h"
+#include "replica.h"
+#include "timeline.h"
+#include "transports/transport.h"
+
+#define IDLE_TIMEOUT 5000 // ms without traffic before a replica that has not committed gives up
+#define LINGER 500 // ms without traffic before a committed replica of push-pull gossip exits
+
+// event loop of replica i in its own process: decode what arrives, process it, encode once per send
+template <class SCHEME, template <class> class PATTERN>
+int run_replica(SCHEME *scm, int i, transport *endpoint) {
+    replica<SCHEME, PATTERN> rep(information(i), scm);
+
+    auto send = [&](const std::vector<int> &dests) {
+        if (!dests.empty()) {
+            message_ptr msg = message::encoded(rep.send(), rep.stamped());
+            for (int dest : dests) {
+                endpoint->send(dest, msg);
+            }
+        }
+        for (int peer : rep.requests()) {
+            endpoint->send(peer, message::encoded(nullptr, rep.stamped()));
+        }
+    };
+
+    if (i == 0) {
+        send(rep.start());
+    }
+
+    // with pulls, a committed replica still answers the peers that ask for the certificate, until they go quiet
+    std::vector<std::vector<uint8_t>> payloads;
+    while ((!rep.end() || rep.pulling) && endpoint->receive(rep.end() ? LINGER : IDLE_TIMEOUT, payloads)) {
+        for (std::vector<uint8_t> &payload : payloads) {
+            message_ptr msg = message::decoded<typename SCHEME::serialized_type>(payload, rep.pulling);
+            if (msg != nullptr) {
+                rep.buffer(msg);
+            }
+            else {
+                std::cerr << "replica " << i << ": dropped a message of " << payload.size() << " bytes that did not decode" << std::endl;
+            }
+        }
+        payloads.clear();
+
+        while (!rep.inbox.empty()) {
+            send(rep.next());
+        }
+    }
+    endpoint->flush(IDLE_TIMEOUT);
+    ::progress.sent(i, endpoint->sent);
+    if (rep.end()) {
+        endpoint->sign_off();
+    }
+
+    return rep.end() ? 0 : 1;
+}
+
+// keys and schemes are created by the parent, each replica then runs in a forked child;
+// succeeds if every replica committed
+template <class SCHEME, template <class> class PATTERN>
+bool launch(std::vector<SCHEME *> &scms, network *net) {
+    if (!net->ready()) {
+        return false;
+    }
+
+    std::cout.flush();
+    std::vector<pid_t> pids;
+    for (int i = 0; i < (int) scms.size(); i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            ::activity.events.clear(); // recorded by the parent before the fork
+            transport *endpoint = net->endpoint(i);
+            int status = run_replica<SCHEME, PATTERN>(scms.at(i), i, endpoint);
+            delete endpoint;
+            if (::activity.enabled()) {
+                // one file per replica process, on the same clock
+                ::activity.write(::activity.path + "." + std::to_string(i));
+            }
+            if (::counting) {
+                ::counters.report();
+            }
+            _exit(status);
+        }
+        pids.push_back(pid);
+    }
+
+    bool success = true;
+    for (pid_t pid : pids) {
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+// all replicas in this process as coroutines on a thread pool: each replica handles its messages one
+// at a time, but different replicas verify, sign and aggregate concurrently
+template <class SCHEME, template <class> class PATTERN>
+class async_cluster {
+public:
+    std::vector<replica<SCHEME, PATTERN>> replicas;
+    executor pool;
+    std::deque<mailbox> boxes;
+
+    std::atomic<int> in_flight{0}; // delivered but not yet handled
+    std::mutex lock;
+    std::condition_variable quiet;
+
+    async_cluster(std::vector<SCHEME *> &scms, int threads) : pool(threads) {
+        for (int i = 0; i < (int) scms.size(); i++) {
+            replicas.emplace_back(information(i), scms.at(i));
+            boxes.emplace_back(pool);
+        }
+    }
+
+    // from replica i
+    void deliver(int i, const message_ptr &msg, const std::vector<int> &dests) {
+        ::progress.sent(i, (long) msg->length * dests.size());
+        in_flight += (int) dests.size();
+        for (int dest : dests) {
+            boxes.at(dest).deliver(msg);
+        }
+    }
+
+    void handled() {
+        if (--in_flight == 0) {
+            std::lock_guard<std::mutex> guard(lock);
+            quiet.notify_all();
+        }
+    }
+
+    detached run(int i) {
+        replica<SCHEME, PATTERN> &rep = replicas.at(i);
+        co_await pool.schedule();
+
+        while (true) {
+            message_ptr msg = co_await boxes.at(i).receive();
+            if (msg == nullptr) {
+                break;
+            }
+
+            // verify and sign
+            rep.buffer(msg);
+            std::vector<int> dests = rep.next();
+
+            std::vector<int> requests = rep.requests();
+            if (!dests.empty() || !requests.empty()) {
+                // aggregate and send, after letting the other replicas run
+                co_await pool.schedule();
+                if (!dests.empty()) {
+                    deliver(i, message::of(rep.send(), rep.stamped()), dests);
+                }
+                if (!requests.empty()) {
+                    deliver(i, message::of(nullptr, rep.stamped()), requests);
+                }
+            }
+            handled();
+        }
+    }
+
+    // succeeds if every replica committed once no message is left in flight
+    bool launch() {
+        for (int i = 0; i < (int) replicas.size(); i++) {
+            run(i);
+        }
+        std::vector<int> dests = replicas.at(0).start();
+        deliver(0, message::of(replicas.at(0).send(), replicas.at(0).stamped()), dests);
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            quiet.wait(guard, [this] { return in_flight.load() == 0; });
+        }
+        for (mailbox &box : boxes) {
+            box.close();
+        }
+        pool.join();
+
+        for (replica<SCHEME, PATTERN> &rep : replicas) {
+            if (!rep.end()) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
@@ -1,4 +1,9 @@
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <thread>
 #include <vector>
 
 #include <privatekey.hpp>
@@ -10,12 +15,25 @@
 #include "arguments.h"
 #include "serialized_signatures/serialized_signatures.h"
 #include "signature_schemes/signature_scheme.h"
+#include "signature_schemes/prepared_keys.h"
+#include "signature_schemes/aggregated_public_keys.h"
 #include "signature_schemes/basic_signatures_scheme.h"
 #include "signature_schemes/multi_signatures_scheme.h"
 #include "signature_schemes/aggregate_signatures_scheme.h"
 #include "signature_schemes/threshold_signatures_scheme.h"
+#include "signature_schemes/pop_multi_signatures_scheme.h"
+#include "signature_schemes/mock_signatures_scheme.h"
+#include "counters.h"
 #include "information.h"
+#include "launcher.h"
+#include "message.h"
+#include "pattern_switch.h"
+#include "progress.h"
 #include "replica.h"
+#include "timeline.h"
+#include "trace.h"
+#include "transports/shm_transport.h"
+#include "transports/tcp_transport.h"
 
 bls::PrivateKey generate_privatekey() {
     uint8_t seed[32];
@@ -23,56 +41,79 @@ bls::PrivateKey generate_privatekey() {
     return bls::PrivateKey::FromSeed(seed, sizeof(seed));
 }
 
-std::vector<signature_scheme *> create_basic_signatures_schemes() {
-    int n = 3*::t + 1;
-
+// generated once: every instance (and pattern, with -S) signs with the same keys and shares their caches
+class replica_keys {
+public:
     std::vector<bls::PrivateKey> sks;
-    std::vector<bls::PublicKey> pks;
-    for (int i = 0; i < n; i++) {
-        sks.push_back(generate_privatekey());
-        pks.push_back(sks.at(i).GetPublicKey());
+    std::unique_ptr<prepared_keys> pks;
+    std::unique_ptr<aggregated_public_keys> agg_pks;
+    std::unique_ptr<pop_aggregated_public_keys> pop_agg_pks;
+    std::unique_ptr<aggregation_infos> infos;
+};
+
+replica_keys & generated_keys() {
+    static replica_keys keys;
+    if (keys.pks == nullptr) {
+        int n = 3*::t + 1;
+
+        std::vector<bls::PublicKey> pks;
+        for (int i = 0; i < n; i++) {
+            keys.sks.push_back(generate_privatekey());
+            pks.push_back(keys.sks.at(i).GetPublicKey());
+        }
+        keys.pks = std::make_unique<prepared_keys>(pks); // shared by all replicas
     }
+    return keys;
+}
 
-    std::vector<signature_scheme *> scms;
-    scms.reserve(n);
-    for (int i = 0;  i < n; i++) {
-        scms.push_back(new basic_signatures_scheme(sks.at(i), pks));
+// the schemes of each type are created once too, and only hand out pointers
+template <class SCHEME, class CREATE>
+std::vector<SCHEME *> schemes(CREATE create) {
+    static std::vector<std::unique_ptr<SCHEME>> owned = create();
+
+    std::vector<SCHEME *> scms;
+    scms.reserve(owned.size());
+    for (std::unique_ptr<SCHEME> &scheme : owned) {
+        scms.push_back(scheme.get());
     }
     return scms;
 }
 
-std::vector<signature_scheme *> create_multi_signatures_schemes() {
-    int n = 3*::t + 1;
+template <class SCHEME>
+std::vector<std::unique_ptr<SCHEME>> create_basic_signatures_schemes() {
+    replica_keys &keys = generated_keys();
 
-    std::vector<bls::PrivateKey> sks;
-    std::vector<bls::PublicKey> pks;
-    for (int i = 0; i < n; i++) {
-        sks.push_back(generate_privatekey());
-        pks.push_back(sks.at(i).GetPublicKey());
+    std::vector<std::unique_ptr<SCHEME>> scms;
+    for (bls::PrivateKey &sk : keys.sks) {
+        scms.push_back(std::make_unique<SCHEME>(sk, keys.pks.get()));
     }
+    return scms;
+}
 
-    std::vector<signature_scheme *> scms;
-    scms.reserve(n);
-    for (int i = 0;  i < n; i++) {
-        scms.push_back(new multi_signatures_scheme(sks.at(i), pks));
+template <class SCHEME>
+std::vector<std::unique_ptr<SCHEME>> create_multi_signatures_schemes() {
+    replica_keys &keys = generated_keys();
+    if (keys.agg_pks == nullptr) {
+        keys.agg_pks = std::make_unique<aggregated_public_keys>(keys.pks.get());
+    }
+
+    std::vector<std::unique_ptr<SCHEME>> scms;
+    for (bls::PrivateKey &sk : keys.sks) {
+        scms.push_back(std::make_unique<SCHEME>(sk, keys.pks.get(), keys.agg_pks.get()));
     }
     return scms;
 }
 
-std::vector<signature_scheme *> create_aggregate_signature_schemes() {
-    int n = 3*::t + 1;
-
-    std::vector<bls::PrivateKey> sks;
-    std::vector<bls::PublicKey> pks;
-    for (int i = 0; i < n; i++) {
-        sks.push_back(generate_privatekey());
-        pks.push_back(sks.at(i).GetPublicKey());
+template <class SCHEME>
+std::vector<std::unique_ptr<SCHEME>> create_aggregate_signature_schemes() {
+    replica_keys &keys = generated_keys();
+    if (keys.infos == nullptr) {
+        keys.infos = std::make_unique<aggregation_infos>(keys.pks.get());
     }
 
-    std::vector<signature_scheme *> scms;
-    scms.reserve(n);
-    for (int i = 0; i < n; i++) {
-        scms.push_back(new aggregate_signatures_scheme(sks.at(i), pks));
+    std::vector<std::unique_ptr<SCHEME>> scms;
+    for (bls::PrivateKey &sk : keys.sks) {
+        scms.push_back(std::make_unique<SCHEME>(sk, keys.pks.get(), keys.infos.get()));
     }
     return scms;
 }
@@ -116,59 +157,432 @@ bls::PublicKey generate_threshold(std::vector<bls::PrivateKey> &secret_shares, i
     return master_pk;
 }
 
-std::vector<signature_scheme *> create_threshold_signatures_schemes() {
-    int n = 3*::t + 1;
-
-    // PrePrepare
+class threshold_keys {
+public:
     bls::PrivateKey preprepare_sk = generate_privatekey();
-    bls::PublicKey preprepare_pk = preprepare_sk.GetPublicKey();
-
-    // Prepare
     std::vector<bls::PrivateKey> prepare_secret_shares;
+    std::vector<bls::PrivateKey> commit_secret_shares;
+    std::unique_ptr<prepared_keys> master_pks;
+    std::unique_ptr<prepared_keys> prepare_pks;
+    std::unique_ptr<prepared_keys> commit_pks;
+};
+
+threshold_keys & generated_threshold_keys() {
+    static threshold_keys keys;
+    if (keys.master_pks == nullptr) {
+        int n = 3*::t + 1;
+
+        // PrePrepare
+        bls::PublicKey preprepare_pk = keys.preprepare_sk.GetPublicKey();
+
+        // Prepare
+        for (int i = 1; i < n; i++) {
+            bn_t b;
+            bn_new(b)
+            keys.prepare_secret_shares.push_back(bls::PrivateKey::FromBN(b));
+        }
+        bls::PublicKey prepare_master_pk = generate_threshold(keys.prepare_secret_shares, 2*::t, 3*::t);
+        std::vector<bls::PublicKey> prepare_pks;
+        for (const bls::PrivateKey& sk : keys.prepare_secret_shares) {
+            prepare_pks.push_back(sk.GetPublicKey());
+        }
+
+        // Commit
+        for (int i = 0; i < n; i++) {
+            bn_t b;
+            bn_new(b)
+            keys.commit_secret_shares.push_back(bls::PrivateKey::FromBN(b));
+        }
+        bls::PublicKey commit_master_pk = generate_threshold(keys.commit_secret_shares, 2*::t + 1, n);
+        std::vector<bls::PublicKey> commit_pks;
+        for (const bls::PrivateKey& sk : keys.commit_secret_shares) {
+            commit_pks.push_back(sk.GetPublicKey());
+        }
+
+        // shared by all replicas
+        keys.master_pks = std::make_unique<prepared_keys>(std::vector<bls::PublicKey>{preprepare_pk, prepare_master_pk, commit_master_pk});
+        keys.prepare_pks = std::make_unique<prepared_keys>(prepare_pks);
+        keys.commit_pks = std::make_unique<prepared_keys>(commit_pks);
+    }
+    return keys;
+}
+
+template <class SCHEME>
+std::vector<std::unique_ptr<SCHEME>> create_threshold_signatures_schemes() {
+    threshold_keys &keys = generated_threshold_keys();
+    int n = 3*::t + 1;
+
+    std::vector<std::unique_ptr<SCHEME>> scms;
+    scms.push_back(std::make_unique<SCHEME>(keys.preprepare_sk, keys.commit_secret_shares[0], keys.master_pks.get(), keys.prepare_pks.get(), keys.commit_pks.get()));
     for (int i = 1; i < n; i++) {
-        bn_t b;
-        bn_new(b)
-        prepare_secret_shares.push_back(bls::PrivateKey::FromBN(b));
+        scms.push_back(std::make_unique<SCHEME>(keys.master_pks.get(), keys.prepare_secret_shares[i-1], keys.commit_secret_shares[i], keys.prepare_pks.get(), keys.commit_pks.get()));
+    }
+    return scms;
+}
+
+// proof of possession: a signature on the (tagged) public key itself, checked once when the key is registered
+bool verify_proof_of_possession(bls::PrivateKey &sk, bls::PublicKey &pk) {
+    uint8_t pop_msg[3 + bls::PublicKey::PUBLIC_KEY_SIZE] = {'P', 'o', 'P'};
+    pk.Serialize(pop_msg + 3);
+    bls::InsecureSignature pop = sk.SignInsecure(pop_msg, sizeof(pop_msg));
+
+    uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
+    bls::Util::Hash256(hash, pop_msg, sizeof(pop_msg));
+    return pop.Verify({hash}, {pk});
+}
+
+template <class SCHEME>
+std::vector<std::unique_ptr<SCHEME>> create_pop_multi_signatures_schemes() {
+    replica_keys &keys = generated_keys();
+    if (keys.pop_agg_pks == nullptr) {
+        for (int i = 0; i < (int) keys.sks.size(); i++) {
+            bls::PublicKey pk = keys.pks->pk(i);
+            if (!verify_proof_of_possession(keys.sks.at(i), pk)) {
+                // no scheme is safe to run on insecure aggregates without it
+                std::cerr << "proof of possession of the key of replica " << i << " does not verify" << std::endl;
+                std::exit(1);
+            }
+        }
+        keys.pop_agg_pks = std::make_unique<pop_aggregated_public_keys>(keys.pks.get());
     }
-    bls::PublicKey prepare_master_pk = generate_threshold(prepare_secret_shares, 2*::t, 3*::t);
-    std::vector<bls::PublicKey> prepare_pks;
-    for (const bls::PrivateKey& sk : prepare_secret_shares) {
-        prepare_pks.push_back(sk.GetPublicKey());
+
+    std::vector<std::unique_ptr<SCHEME>> scms;
+    for (bls::PrivateKey &sk : keys.sks) {
+        scms.push_back(std::make_unique<SCHEME>(sk, keys.pks.get(), keys.pop_agg_pks.get()));
     }
+    return scms;
+}
 
-    // Commit
-    std::vector<bls::PrivateKey> commit_secret_shares;
+// no keys, the mock scheme only counts signers
+template <class SCHEME>
+std::vector<std::unique_ptr<SCHEME>> create_mock_signatures_schemes() {
+    int n = 3*::t + 1;
+
+    std::vector<std::unique_ptr<SCHEME>> scms;
+    for (int i = 0;  i < n; i++) {
+        scms.push_back(std::make_unique<SCHEME>());
+    }
+    return scms;
+}
+
+pattern_switch switcher;
+int failed = 0; // instances some replica did not commit
+
+// one step of a replica for the trace: it started at start and ends now, after sending msg (or nothing)
+template <class SCHEME, template <class> class PATTERN>
+trace_step trace_of(replica<SCHEME, PATTERN> &r, std::chrono::steady_clock::time_point origin, std::chrono::steady_clock::time_point start,
+        int trigger, const message *msg, const std::vector<int> &dests) {
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    int i = r.smr.info.i;
+
+    trace_step s;
+    s.time = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+    s.cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    s.replica = i;
+    s.trigger = trigger;
+    s.state = (r.smr.sigs->contains_prepare(i) ? trace_step::OWN_PREPARE : 0)
+            | (r.smr.sigs->contains_commit(i) ? trace_step::OWN_COMMIT : 0)
+            | (r.smr.sigs->prepared() ? trace_step::PREPARED : 0)
+            | (r.smr.sigs->committed() ? trace_step::COMMITTED : 0);
+    s.bytes = msg != nullptr ? msg->length : 0;
+    s.dests = dests;
+    return s;
+}
+
+// one consensus instance, false if some replica did not commit
+template <class SCHEME, template <class> class PATTERN>
+bool execute(std::vector<SCHEME *> scms) {
+    if (::mode == SOCKETS) {
+        tcp_network net((int) scms.size(), ::port);
+        return launch<SCHEME, PATTERN>(scms, &net);
+    }
+    if (::mode == ASYNC) {
+        async_cluster<SCHEME, PATTERN> cluster(scms, ::threads);
+        return cluster.launch();
+    }
+    if (::mode == SHAREDMEM || ::mode == SHAREDMEMPOLL) {
+        shm_network net((int) scms.size(), ::mode == SHAREDMEMPOLL);
+        return launch<SCHEME, PATTERN>(scms, &net);
+    }
+
+    int n = 3*::t + 1;
+    std::vector<replica<SCHEME, PATTERN>> replicas;
+        /*std::vector<std::vector<std::chrono::milliseconds>> durations;
+        std::vector<std::vector<int>> sent_msgs;
+        std::vector<std::vector<int>> rcvd_msgs;*/
     for (int i = 0; i < n; i++) {
-        bn_t b;
-        bn_new(b)
-        commit_secret_shares.push_back(bls::PrivateKey::FromBN(b));
+        replicas.emplace_back(information(i), scms.at(i));
+            /*durations.emplace_back();
+            sent_msgs.emplace_back();
+            rcvd_msgs.emplace_back();*/
+    }
+
+    // step of the message at the front of each inbox, when tracing
+    std::vector<std::queue<int>> triggers(::tracer.enabled() ? n : 0);
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    if (::tracer.enabled()) {
+        ::tracer.instance(n);
     }
-    bls::PublicKey commit_master_pk = generate_threshold(commit_secret_shares, 2*::t + 1, n);
-    std::vector<bls::PublicKey> commit_pks;
-    for (const bls::PrivateKey& sk : commit_secret_shares) {
-        commit_pks.push_back(sk.GetPublicKey());
+
+        //std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+    std::vector<int> pending = replicas.at(0).start();
+    message_ptr msg = message::of(replicas.at(0).send(), replicas.at(0).stamped());
+    ::progress.sent(0, (long) msg->length * pending.size());
+        /*std::chrono::time_point<std::chrono::steady_clock> end = std::chrono::steady_clock::now();
+        durations.at(0).push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
+        sent_msgs.at(0).insert(sent_msgs.at(0).end(), pending.size(), msg->ser_sigs->length());*/
+    if (::tracer.enabled()) {
+        int step = ::tracer.step(trace_of(replicas.at(0), origin, origin, -1, msg.get(), pending));
+        for (int dest : pending) {
+            triggers.at(dest).push(step);
+        }
     }
 
-    std::vector<signature_scheme *> scms;
-    scms.push_back(new threshold_signatures_scheme(preprepare_sk, preprepare_pk, prepare_pks, prepare_master_pk, commit_secret_shares[0], commit_pks, commit_master_pk));
-    for (int i = 1; i < n; i++) {
-        scms.push_back(new threshold_signatures_scheme(preprepare_pk, prepare_secret_shares[i-1], prepare_pks, prepare_master_pk, commit_secret_shares[i], commit_pks, commit_master_pk));
+    for (int dest : pending) {
+        replicas.at(dest).buffer(msg);
+            //rcvd_msgs.at(dest).insert(rcvd_msgs.at(dest).end(), msg->ser_sigs->length());
+    }
+    for (unsigned long ii = 0; ii < pending.size(); ii++) {
+        int i = pending[ii];
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<int> dests = replicas.at(i).next();
+            //end = std::chrono::steady_clock::now();
+
+        msg = nullptr;
+        if (!dests.empty()) {
+            msg = message::of(replicas.at(i).send(), replicas.at(i).stamped());
+            ::progress.sent(i, (long) msg->length * dests.size());
+                //end = std::chrono::steady_clock::now();
+                //sent_msgs.at(i).insert(sent_msgs.at(i).end(), dests.size(), msg->ser_sigs->length());
+
+            for (int dest : dests) {
+                replicas.at(dest).buffer(msg);
+                    //rcvd_msgs.at(dest).insert(rcvd_msgs.at(dest).end(), msg->ser_sigs->length());
+            }
+            pending.insert(pending.end(), dests.begin(), dests.end());
+        }
+        // stamps alone, asking peers for their state
+        std::vector<int> requests = replicas.at(i).requests();
+        if (!requests.empty()) {
+            message_ptr request = message::of(nullptr, replicas.at(i).stamped());
+            ::progress.sent(i, (long) request->length * requests.size());
+            for (int peer : requests) {
+                replicas.at(peer).buffer(request);
+            }
+            pending.insert(pending.end(), requests.begin(), requests.end());
+        }
+        if (::tracer.enabled()) {
+            int step = ::tracer.step(trace_of(replicas.at(i), origin, start, triggers.at(i).front(), msg.get(), dests));
+            triggers.at(i).pop();
+            for (int dest : dests) {
+                triggers.at(dest).push(step);
+            }
+            for (int peer : requests) {
+                triggers.at(peer).push(step);
+            }
+        }
+            //durations.at(i).push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
+    }
+    if (::tracer.enabled()) {
+        ::tracer.flush();
+    }
+
+    bool success = true;
+    for (int i = 0; i < n; i++) {
+        if (!replicas.at(i).end()) {
+            success = false;
+            break;
+        }
+    }
+    if (success) {
+        /*std::chrono::milliseconds global_duration(0);
+        for (int i = 0; i < n; i++) {
+            std::chrono::milliseconds total_duration(0);
+            for (std::chrono::milliseconds duration : durations.at(i)) {
+                total_duration += duration;
+            }
+            int min_sent_msg_length = INT_MAX;
+            int sent_msgs_length = 0;
+            int max_sent_msg_length = 0;
+            for (int length : sent_msgs.at(i)) {
+                min_sent_msg_length = std::min(length, min_sent_msg_length);
+                sent_msgs_length += length;
+                max_sent_msg_length = std::max(length, max_sent_msg_length);
+            }
+            int min_rcvd_msg_length = INT_MAX;
+            int rcvd_msgs_length = 0;
+            int max_rcvd_msg_length = 0;
+            for (int length : rcvd_msgs.at(i)) {
+                min_rcvd_msg_length = std::min(length, min_rcvd_msg_length);
+                rcvd_msgs_length += length;
+                max_rcvd_msg_length = std::max(length, max_rcvd_msg_length);
+            }
+
+            std::cout << i << "";
+            std::cout << "," << total_duration.count();
+            std::cout << "," << sent_msgs.at(i).size();
+            if (true) {
+                std::cout << "," << ((float) sent_msgs_length) / sent_msgs.at(i).size();
+                //std::cout << ";" << min_sent_msg_length << "," << ((float) sent_msgs_length) / sent_msgs.at(i).size() << "," << max_sent_msg_length;
+            }
+            else {
+                std::cout << ";";
+                for (int length : sent_msgs.at(i)) {
+                    std::cout << "," << length;
+                }
+            }
+            std::cout << "," << rcvd_msgs.at(i).size();
+            if (true) {
+                std::cout << "," << ((float) rcvd_msgs_length) / rcvd_msgs.at(i).size();
+                //std::cout << ";" << min_rcvd_msg_length << "," << ((float) rcvd_msgs_length) / rcvd_msgs.at(i).size() << "," << max_rcvd_msg_length;
+            }
+            else {
+                std::cout << ";";
+                for (int length : rcvd_msgs.at(i)) {
+                    std::cout << "," << length;
+                }
+            }
+            std::cout << endl;
+        }*/
+    }
+    return success;
+}
+
+template <class SCHEME, template <class> class PATTERN>
+void run(std::vector<SCHEME *> scms) {
+    if (scms.empty()) {
+        return;
+    }
+
+    if constexpr (requires { scms.at(0)->charged; }) {
+        // the schemes outlive the instance, only this one is charged
+        for (SCHEME *scheme : scms) {
+            scheme->charged = 0;
+        }
+    }
+
+    ::progress.begin((int) scms.size());
+    if (!execute<SCHEME, PATTERN>(scms)) {
+        // not measured for the switch, it did not finish
+        std::cerr << "instance " << ::instance << ": not every replica committed" << std::endl;
+        ::failed++;
+        return;
+    }
+    if (::switching) {
+        phase_latency latency = ::progress.measured();
+        switcher.record(::patt, latency);
+        std::cerr << "pattern " << ::patt << ": prepare " << latency.prepare << " ms, commit " << latency.commit << " ms, " << latency.bytes << " bytes" << std::endl;
+    }
+    if constexpr (requires { scms.at(0)->charged; }) {
+        // only the replicas of this process are charged, i.e. -mI or -mA
+        long max = 0;
+        long total = 0;
+        for (SCHEME *scheme : scms) {
+            max = std::max(max, scheme->charged);
+            total += scheme->charged;
+        }
+        std::cerr << "modelled cpu: " << max / 1e6 << " ms max, " << total / 1e6 << " ms total" << std::endl;
     }
-    return scms;
 }
 
-std::vector<signature_scheme *> create_signature_schemes() {
+// every policy combination is instantiated; the one selected by the arguments is picked once here
+template <int PATT, template <class> class PATTERN, int EVAL, int AGG, int VER>
+void run() {
     switch (::scm) {
         case BASICSIG:
-            return create_basic_signatures_schemes();
+            run<basic_signatures_scheme<PATT, VER>, PATTERN>(schemes<basic_signatures_scheme<PATT, VER>>(create_basic_signatures_schemes<basic_signatures_scheme<PATT, VER>>));
+            break;
         case MULTISIG:
-            return create_multi_signatures_schemes();
+            run<multi_signatures_scheme<PATT, EVAL, AGG, VER>, PATTERN>(schemes<multi_signatures_scheme<PATT, EVAL, AGG, VER>>(create_multi_signatures_schemes<multi_signatures_scheme<PATT, EVAL, AGG, VER>>));
+            break;
         case AGGREGATESIG:
-            return create_aggregate_signature_schemes();
+            run<aggregate_signatures_scheme<EVAL, VER>, PATTERN>(schemes<aggregate_signatures_scheme<EVAL, VER>>(create_aggregate_signature_schemes<aggregate_signatures_scheme<EVAL, VER>>));
+            break;
         case THRESHOLDSIG:
-            return create_threshold_signatures_schemes();
-        default:
-            return {};
+            run<threshold_signatures_scheme<PATT, VER>, PATTERN>(schemes<threshold_signatures_scheme<PATT, VER>>(create_threshold_signatures_schemes<threshold_signatures_scheme<PATT, VER>>));
+            break;
+        case POPMULTISIG:
+            run<pop_multi_signatures_scheme<PATT, EVAL, VER>, PATTERN>(schemes<pop_multi_signatures_scheme<PATT, EVAL, VER>>(create_pop_multi_signatures_schemes<pop_multi_signatures_scheme<PATT, EVAL, VER>>));
+            break;
+        case MOCKSIG:
+            run<mock_signatures_scheme<PATT, VER>, PATTERN>(schemes<mock_signatures_scheme<PATT, VER>>(create_mock_signatures_schemes<mock_signatures_scheme<PATT, VER>>));
+            break;
+    }
+}
+
+template <int PATT, template <class> class PATTERN, int EVAL, int AGG>
+void run() {
+    switch (::ver) {
+        case INDIVIDUAL:
+            run<PATT, PATTERN, EVAL, AGG, INDIVIDUAL>();
+            break;
+        case BYMSG:
+            run<PATT, PATTERN, EVAL, AGG, BYMSG>();
+            break;
+        case BATCH:
+            run<PATT, PATTERN, EVAL, AGG, BATCH>();
+            break;
+    }
+}
+
+template <int PATT, template <class> class PATTERN, int EVAL>
+void run() {
+    switch (::agg) {
+        case INFOSMERGE:
+            run<PATT, PATTERN, EVAL, INFOSMERGE>();
+            break;
+        case PKAGG:
+            run<PATT, PATTERN, EVAL, PKAGG>();
+            break;
+    }
+}
+
+template <int PATT, template <class> class PATTERN>
+void run() {
+    switch (::eval) {
+        case LAZY:
+            run<PATT, PATTERN, LAZY>();
+            break;
+        case EAGER:
+            run<PATT, PATTERN, EAGER>();
+            break;
+        case BACKGROUND:
+            run<PATT, PATTERN, BACKGROUND>();
+            break;
+        case ADAPTIVE:
+            run<PATT, PATTERN, ADAPTIVE>();
+            break;
+    }
+}
+
+void run() {
+    switch (::patt) {
+        case BROADCAST:
+            run<BROADCAST, broadcast>();
+            break;
+        case CENTRALIZED:
+            run<CENTRALIZED, centralized>();
+            break;
+        case RING:
+            run<RING, ring>();
+            break;
+        case GOSSIP:
+            run<GOSSIP, gossip>();
+            break;
+        case HIERARCHICAL:
+            run<HIERARCHICAL, hierarchical>();
+            break;
+        case SHARDED:
+            run<SHARDED, sharded>();
+            break;
+        case BIRING:
+            run<BIRING, bidirectional_ring>();
+            break;
+        case DIGESTGOSSIP:
+            // same signatures as gossip, only the destinations differ
+            run<GOSSIP, push_pull_gossip>();
+            break;
     }
 }
 
@@ -176,10 +590,18 @@ int main(int argc, const char* argv[]) {
     ::t = 1;
     ::patt = BROADCAST;
     ::scm = BASICSIG;
-    ::eval = LAZY; // || EAGER;
+    ::eval = LAZY; // || EAGER || BACKGROUND || ADAPTIVE;
     ::agg = INFOSMERGE; // || PKAGG;
     ::ver = INDIVIDUAL; // || BYMSG || BATCH;
-
+    ::workers = 1;
+    ::mode = INPROCESS; // || ASYNC || SOCKETS || SHAREDMEM || SHAREDMEMPOLL;
+    ::presign = 0;
+    ::instances = 1;
+    ::switching = 0;
+    ::bandwidth = 0;
+    ::counting = 0;
+
+    std::string group_spec;
     for (int i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
             switch (argv[i][1]) {
@@ -196,10 +618,19 @@ int main(int argc, const char* argv[]) {
                             break;
                         case 'C':
                             ::patt = CENTRALIZED;
+                            if (argv[i][3] == '=' && std::stoi(argv[i] + 4) > 1) {
+                                // k collectors, each for a slice of consecutive replicas
+                                ::patt = SHARDED;
+                                group_spec = argv[i] + 4;
+                            }
                             break;
                         case 'R':
                             ::patt = RING;
                             break;
+                        case 'B':
+                            // ring in both directions
+                            ::patt = BIRING;
+                            break;
                         case 'G':
                             ::patt = GOSSIP;
                             ::f = 2;
@@ -207,8 +638,44 @@ int main(int argc, const char* argv[]) {
                                 ::f = std::stoi(argv[i] + 4);
                             }
                             break;
+                        case 'P':
+                            // push-pull gossip: messages stamped with what their sender has, quorums a peer misses answered or asked for
+                            ::patt = DIGESTGOSSIP;
+                            ::f = 2;
+                            if (argv[i][3] == '=') {
+                                ::f = std::stoi(argv[i] + 4);
+                            }
+                            break;
+                        case 'H':
+                            // regions given as a count of consecutive groups or a file of one region per replica
+                            ::patt = HIERARCHICAL;
+                            group_spec = argv[i][3] == '=' ? argv[i] + 4 : "2";
+                            break;
+                        case 'A':
+                            // switched between instances by the leader, from measured latency and bytes
+                            ::switching = 1;
+                            break;
                     }
                     break;
+                case 'o':
+                    // argv[i][2] == '='
+                    // seeded expander overlay for gossip, the same in every run of a seed
+                    ::seed = (unsigned) std::stoul(argv[i] + 3);
+                    break;
+                case 'd':
+                    // gossip fanout adapted to the redundancy of received messages
+                    ::adapting = true;
+                    break;
+                case 'i':
+                    // argv[i][2] == '='
+                    // consecutive consensus instances
+                    ::instances = std::stoi(argv[i] + 3);
+                    break;
+                case 'b':
+                    // argv[i][2] == '='
+                    // available bandwidth in bytes/ms, weighs bytes against latency when switching patterns
+                    ::bandwidth = std::stoi(argv[i] + 3);
+                    break;
                 case 's':
                     // crypto scheme
                     switch (argv[i][2]) {
@@ -224,6 +691,38 @@ int main(int argc, const char* argv[]) {
                         case 'T':
                             ::scm = THRESHOLDSIG;
                             break;
+                        case 'P':
+                            ::scm = POPMULTISIG;
+                            break;
+                        case 'X':
+                            // signer sets only, curve operations charged from the cost model
+                            ::scm = MOCKSIG;
+                            break;
+                    }
+                    break;
+                case 'T':
+                    // argv[i][2] == '='
+                    // binary trace of every replica step (-mI only), see trace.h and replay.cpp
+                    if (!::tracer.open(argv[i] + 3)) {
+                        std::cerr << "cannot write " << argv[i] + 3 << std::endl;
+                        return 1;
+                    }
+                    break;
+                case 'H':
+                    // hardware counters (perf_event_open) per replica and phase
+                    ::counting = 1;
+                    break;
+                case 'J':
+                    // argv[i][2] == '='
+                    // chrome trace of when each replica received, verified, signed, serialized and routed
+                    ::activity.path = argv[i] + 3;
+                    break;
+                case 'c':
+                    // argv[i][2] == '='
+                    // cost model of the mock scheme, "<operation> <ns>" lines
+                    if (!::costs.load(argv[i] + 3)) {
+                        std::cerr << "cannot read " << argv[i] + 3 << std::endl;
+                        return 1;
                     }
                     break;
                 case 'e':
@@ -236,6 +735,14 @@ int main(int argc, const char* argv[]) {
                             // eager (immediate) aggregation/merging
                             ::eval = EAGER;
                             break;
+                        case 'B':
+                            // lazy, with pending signatures folded by a background worker
+                            ::eval = BACKGROUND;
+                            break;
+                        case 'A':
+                            // eager or lazy per phase, from the measured arrival gaps and aggregation cost
+                            ::eval = ADAPTIVE;
+                            break;
                     }
                     break;
                 case 'a':
@@ -250,6 +757,47 @@ int main(int argc, const char* argv[]) {
                             break;
                     }
                     break;
+                case 'P':
+                    // prepare and commit signed ahead of time on the aggregation worker
+                    ::presign = 1;
+                    break;
+                case 'w':
+                    // argv[i][2] == '='
+                    // worker threads (e.g. batched signature decompression)
+                    ::workers = std::stoi(argv[i] + 3);
+                    break;
+                case 'm':
+                    switch (argv[i][2]) {
+                        case 'I':
+                            // all replicas in this process
+                            ::mode = INPROCESS;
+                            break;
+                        case 'A':
+                            // all replicas in this process, as coroutines on a thread pool
+                            ::mode = ASYNC;
+                            ::threads = (int) std::max(std::thread::hardware_concurrency(), 1u);
+                            if (argv[i][3] == '=') {
+                                ::threads = std::stoi(argv[i] + 4);
+                            }
+                            break;
+                        case 'S':
+                            // one process per replica, over loopback sockets
+                            ::mode = SOCKETS;
+                            ::port = 7000;
+                            if (argv[i][3] == '=') {
+                                ::port = std::stoi(argv[i] + 4);
+                            }
+                            break;
+                        case 'M':
+                            // one process per replica, over shared-memory rings (futex waits)
+                            ::mode = SHAREDMEM;
+                            break;
+                        case 'B':
+                            // one process per replica, over shared-memory rings (busy-polling)
+                            ::mode = SHAREDMEMPOLL;
+                            break;
+                    }
+                    break;
                 case 'v':
                     switch (argv[i][2]) {
                         case 'I':
@@ -270,116 +818,29 @@ int main(int argc, const char* argv[]) {
         }
     }
 
-    std::vector<signature_scheme *> scms = create_signature_schemes();
-
-    int n = 3*::t + 1;
-    std::vector<replica> replicas;
-        /*std::vector<std::vector<std::chrono::milliseconds>> durations;
-        std::vector<std::vector<int>> sent_msgs;
-        std::vector<std::vector<int>> rcvd_msgs;*/
-    for (int i = 0; i < n; i++) {
-        replicas.emplace_back(information(i), scms.at(i));
-            /*durations.emplace_back();
-            sent_msgs.emplace_back();
-            rcvd_msgs.emplace_back();*/
+    if (::patt == HIERARCHICAL || ::patt == SHARDED) {
+        ::groups = read_groups(group_spec, 3*::t + 1);
+        if (::switching) {
+            switcher.add_grouped();
+        }
     }
-
-        //std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
-    std::vector<int> pending = replicas.at(0).start();
-    serialized_signatures *ser = replicas.at(0).send();
-        /*std::chrono::time_point<std::chrono::steady_clock> end = std::chrono::steady_clock::now();
-        durations.at(0).push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
-        sent_msgs.at(0).insert(sent_msgs.at(0).end(), pending.size(), ser->length());*/
-
-        bool first;
-        first = true;
-    for (int dest : pending) {
-        replicas.at(dest).buffer(ser);
-            //rcvd_msgs.at(dest).insert(rcvd_msgs.at(dest).end(), ser->length());
-            if (first) first = false; else std::cout << ","; std::cout << dest; // parallel
+    if (::switching && ::f == 0) {
+        ::f = 2;
     }
-    for (unsigned long ii = 0; ii < pending.size(); ii++) {
-        int i = pending[ii];
-
-            //start = std::chrono::steady_clock::now();
-        std::vector<int> dests = replicas.at(i).next();
-            //end = std::chrono::steady_clock::now();
-
-            std::cout << ";"; // parallel
-        if (!dests.empty()) {
-            ser = replicas.at(i).send();
-                //end = std::chrono::steady_clock::now();
-                //sent_msgs.at(i).insert(sent_msgs.at(i).end(), dests.size(), ser->length());
-
-                first = true;
-            for (int dest : dests) {
-                replicas.at(dest).buffer(ser);
-                    //rcvd_msgs.at(dest).insert(rcvd_msgs.at(dest).end(), ser->length());
-                    if (first) first = false; else std::cout << ","; std::cout << dest; // parallel
-            }
-            pending.insert(pending.end(), dests.begin(), dests.end());
+    for (int k = 0; k < ::instances; k++) {
+        ::instance = k;
+        if (::switching) {
+            ::patt = switcher.next();
         }
-            //durations.at(i).push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start));
-    }
-        std::cout << endl; // parallel
-
-    bool success = true;
-    for (int i = 0; i < n; i++) {
-        if (!replicas.at(i).end()) {
-            success = false;
-            break;
+        ::activity.begin(k, 3*::t + 1);
+        ::counters.begin(k, 3*::t + 1);
+        run();
+        if (::counting) {
+            ::counters.report();
         }
     }
-    if (success) {
-        /*std::chrono::milliseconds global_duration(0);
-        for (int i = 0; i < n; i++) {
-            std::chrono::milliseconds total_duration(0);
-            for (std::chrono::milliseconds duration : durations.at(i)) {
-                total_duration += duration;
-            }
-            int min_sent_msg_length = INT_MAX;
-            int sent_msgs_length = 0;
-            int max_sent_msg_length = 0;
-            for (int length : sent_msgs.at(i)) {
-                min_sent_msg_length = std::min(length, min_sent_msg_length);
-                sent_msgs_length += length;
-                max_sent_msg_length = std::max(length, max_sent_msg_length);
-            }
-            int min_rcvd_msg_length = INT_MAX;
-            int rcvd_msgs_length = 0;
-            int max_rcvd_msg_length = 0;
-            for (int length : rcvd_msgs.at(i)) {
-                min_rcvd_msg_length = std::min(length, min_rcvd_msg_length);
-                rcvd_msgs_length += length;
-                max_rcvd_msg_length = std::max(length, max_rcvd_msg_length);
-            }
-
-            std::cout << i << "";
-            std::cout << "," << total_duration.count();
-            std::cout << "," << sent_msgs.at(i).size();
-            if (true) {
-                std::cout << "," << ((float) sent_msgs_length) / sent_msgs.at(i).size();
-                //std::cout << ";" << min_sent_msg_length << "," << ((float) sent_msgs_length) / sent_msgs.at(i).size() << "," << max_sent_msg_length;
-            }
-            else {
-                std::cout << ";";
-                for (int length : sent_msgs.at(i)) {
-                    std::cout << "," << length;
-                }
-            }
-            std::cout << "," << rcvd_msgs.at(i).size();
-            if (true) {
-                std::cout << "," << ((float) rcvd_msgs_length) / rcvd_msgs.at(i).size();
-                //std::cout << ";" << min_rcvd_msg_length << "," << ((float) rcvd_msgs_length) / rcvd_msgs.at(i).size() << "," << max_rcvd_msg_length;
-            }
-            else {
-                std::cout << ";";
-                for (int length : rcvd_msgs.at(i)) {
-                    std::cout << "," << length;
-                }
-            }
-            std::cout << endl;
-        }*/
+    if (::activity.enabled() && !::activity.write(::activity.path)) {
+        std::cerr << "cannot write " << ::activity.path << std::endl;
     }
+    return ::failed > 0 ? 1 : 0;
 }
-
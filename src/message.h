@@ -0,0 +1,106 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "arguments.h"
+#include "digest.h"
+#include "serialized_signatures/serialized_signatures.h"
+#include "serialized_signatures/wire.h"
+
+class message;
+
+using message_ptr = std::shared_ptr<const message>;
+
+// who sent a message and the signers it had, with push-pull gossip (-pP)
+class stamp {
+public:
+    int sender;
+    digest known;
+
+    // on the wire ahead of the signatures: the sender, both signer bitmaps and whether signatures follow
+    static int length() {
+        return 2 + 2 * bitmap::length(3*::t + 1) + 1;
+    }
+};
+
+// one sent serialized signatures, shared read-only by all its destinations and released with the last
+// of them; the signature bytes it points to belong to the signatures that produced them and outlive it
+class message {
+public:
+    std::unique_ptr<serialized_signatures> ser_sigs; // null for an encoded message, or a request (a stamp alone)
+    std::vector<uint8_t> frame; // 4-byte little-endian length + wire encoding, empty unless encoded
+    int length = 0; // of the serialized signatures and the stamp, the bytes counted as sent in every mode
+    std::optional<stamp> from;
+
+    // in-process delivery, no encoding
+    static message_ptr of(serialized_signatures *ser_sigs, std::optional<stamp> from = std::nullopt) {
+        auto msg = std::make_shared<message>();
+        msg->ser_sigs.reset(ser_sigs);
+        msg->length = (ser_sigs != nullptr ? ser_sigs->length() : 0) + (from.has_value() ? stamp::length() : 0);
+        msg->from = std::move(from);
+        return msg;
+    }
+
+    // encoded once however many destinations it is sent to
+    static message_ptr encoded(serialized_signatures *ser_sigs, std::optional<stamp> from = std::nullopt) {
+        auto msg = std::make_shared<message>();
+        msg->length = (ser_sigs != nullptr ? ser_sigs->length() : 0) + (from.has_value() ? stamp::length() : 0);
+        msg->frame.resize(4);
+        if (from.has_value()) {
+            int n = 3*::t + 1;
+            wire_writer w(msg->frame);
+            w.put_u16(from->sender);
+            w.put_bitmap(from->known.prepares, n);
+            w.put_bitmap(from->known.commits, n);
+            w.put_u8(ser_sigs != nullptr);
+        }
+        if (ser_sigs != nullptr) {
+            ser_sigs->encode(msg->frame);
+        }
+        auto size = (uint32_t) (msg->frame.size() - 4);
+        for (int b = 0; b < 4; b++) {
+            msg->frame[b] = (size >> (8 * b)) & 0xff;
+        }
+        delete ser_sigs;
+        return msg;
+    }
+
+    // a received payload, stamped or not as the pattern sends them; null if it does not decode
+    template <class SERIALIZED>
+    static message_ptr decoded(const std::vector<uint8_t> &payload, bool stamped) {
+        size_t pos = 0;
+        std::optional<stamp> from;
+        bool signatures = true;
+        if (stamped) {
+            int n = 3*::t + 1;
+            wire_reader r(payload.data(), std::min(payload.size(), (size_t) stamp::length()));
+            int sender = r.get_id();
+            bitmap prepares = r.get_bitmap(n);
+            bitmap commits = r.get_bitmap(n);
+            signatures = r.get_u8() != 0;
+            if (!r.done()) {
+                return nullptr;
+            }
+            from = stamp {sender, {prepares, commits}};
+            pos = r.pos;
+        }
+        serialized_signatures *ser_sigs = nullptr;
+        if (signatures) {
+            ser_sigs = SERIALIZED::decode(payload.data() + pos, payload.size() - pos);
+            if (ser_sigs == nullptr) {
+                return nullptr;
+            }
+        }
+        else if (pos != payload.size()) {
+            return nullptr;
+        }
+        return of(ser_sigs, std::move(from));
+    }
+};
+
+#endif
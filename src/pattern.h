@@ -2,49 +2,75 @@
 #define MUTATION_H
 
 #include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <optional>
 #include <random>
 #include <vector>
 
+#include "digest.h"
+#include "groups.h"
 #include "information.h"
 #include "signatures/signatures.h"
 
+// what the patterns check of the last sent state, instead of a copy of the whole signatures
+class snapshot {
+public:
+    bool own_commit;
+    bool committed;
+
+    template <class SIGS>
+    static snapshot of(SIGS *sigs, int i) {
+        return {sigs->contains_commit(i), sigs->committed()};
+    }
+};
+
+// patterns are instantiated for the concrete signatures type of the scheme, so the checks on
+// the next state are direct calls
+template <class SIGS>
 class pattern {
 public:
     information info;
-    signatures *previous;
-
-    explicit pattern(information &info) : info(info), previous(nullptr) {}
+    std::optional<snapshot> previous;
 
-    virtual std::vector<int> destinations(signatures *) = 0;
+    explicit pattern(information &info) : info(info) {}
 };
 
-class broadcast : public pattern {
+template <class SIGS>
+class broadcast final : public pattern<SIGS> {
 public:
-    explicit broadcast(information info) : pattern(info) {}
+    using pattern<SIGS>::info;
+    using pattern<SIGS>::previous;
 
-    std::vector<int> destinations(signatures *next) override {
-        if (previous == nullptr || (!previous->contains_commit(info.i) && next->contains_commit(info.i))) {
-            previous = next->clone();
+    explicit broadcast(information info) : pattern<SIGS>(info) {}
+
+    std::vector<int> destinations(SIGS *next) {
+        if (!previous.has_value() || (!previous->own_commit && next->contains_commit(info.i))) {
+            previous = snapshot::of(next, info.i);
             return info.replicas;
         }
         return {};
     }
 };
 
-class centralized : public pattern {
+template <class SIGS>
+class centralized final : public pattern<SIGS> {
 public:
-    explicit centralized(information info) : pattern(info) {}
+    using pattern<SIGS>::info;
+    using pattern<SIGS>::previous;
+
+    explicit centralized(information info) : pattern<SIGS>(info) {}
 
-    std::vector<int> destinations(signatures *next) override {
+    std::vector<int> destinations(SIGS *next) {
         if (info.i == 0) {
-            if (previous == nullptr || (!previous->contains_commit(info.i) && next->contains_commit(info.i)) || (!previous->committed() && next->committed())) {
-                previous = next->clone();
+            if (!previous.has_value() || (!previous->own_commit && next->contains_commit(info.i)) || (!previous->committed && next->committed())) {
+                previous = snapshot::of(next, info.i);
                 return info.replicas;
             }
         }
         else {
-            if (previous == nullptr || (!previous->contains_commit(info.i) && next->contains_commit(info.i))) {
-                previous = next->clone();
+            if (!previous.has_value() || (!previous->own_commit && next->contains_commit(info.i))) {
+                previous = snapshot::of(next, info.i);
                 return {0};
             }
         }
@@ -52,13 +78,17 @@ public:
     }
 };
 
-class ring : public pattern {
+template <class SIGS>
+class ring final : public pattern<SIGS> {
 public:
-    explicit ring(information info) : pattern(info) {}
+    using pattern<SIGS>::info;
+    using pattern<SIGS>::previous;
 
-    std::vector<int> destinations(signatures *next) override {
-        if (previous == nullptr || (!previous->contains_commit(info.i) && next->contains_commit(info.i)) || (!previous->committed() && next->committed())) {
-            previous = next->clone();
+    explicit ring(information info) : pattern<SIGS>(info) {}
+
+    std::vector<int> destinations(SIGS *next) {
+        if (!previous.has_value() || (!previous->own_commit && next->contains_commit(info.i)) || (!previous->committed && next->committed())) {
+            previous = snapshot::of(next, info.i);
             int n = 3*::t + 1;
             return {(info.i + 1) % n};
         }
@@ -66,22 +96,409 @@ public:
     }
 };
 
+// ring in both directions: the prepares flow from the leader both ways and meet halfway, where the commits
+// start back towards the leader, which then sends the commit certificate out along both flows again; a
+// round takes about 3n/2 hops instead of more than 2n, and as each state only goes on to the neighbour
+// that does not have it yet, every link carries about half of what a ring link does
+template <class SIGS>
+class bidirectional_ring final : public pattern<SIGS> {
+public:
+    using pattern<SIGS>::info;
+    using pattern<SIGS>::previous;
+
+    std::vector<int> away; // neighbours farther from the leader, both for the leader
+    std::vector<int> toward; // nearer, none for the leader
+    bool passed = false; // the flow from the leader went on away
+
+    explicit bidirectional_ring(information info) : pattern<SIGS>(info) {
+        int n = 3*::t + 1;
+        int i = info.i;
+        if (i == 0) {
+            away = {1, n - 1};
+        }
+        else if (i <= n - i) {
+            away = {i + 1};
+            toward = {i - 1};
+        }
+        else {
+            away = {i - 1};
+            toward = {(i + 1) % n};
+        }
+    }
+
+    // prepares of the other replicas
+    int others(SIGS *next) {
+        int count = 0;
+        for (int i = 0; i < 3*::t + 1; i++) {
+            count += i != info.i && next->contains_prepare(i);
+        }
+        return count;
+    }
+
+    std::vector<int> destinations(SIGS *next) {
+        snapshot now = snapshot::of(next, info.i);
+        bool committing = now.committed && !(previous.has_value() && previous->committed);
+        bool signing = now.own_commit && !(previous.has_value() && previous->own_commit);
+        previous = now;
+
+        if (committing) {
+            // the certificate goes on away from the leader
+            passed = true;
+            return away;
+        }
+        std::vector<int> dests;
+        // the flow from this replica's side reached it (the leader's neighbours cannot tell it from the other
+        // flow but by whether it prepared them), passed on away once, or as soon as the other flow prepared
+        // this replica: all the other prepares it has then came from that side, which only needs its own if it
+        // was not prepared already
+        bool reached = info.i == 0 || (toward.at(0) == 0 ? !signing : next->contains_prepare(toward.at(0)));
+        if (!passed && (reached || signing)) {
+            passed = true;
+            if (reached || others(next) < 2*::t) {
+                dests = away;
+            }
+        }
+        if (signing) {
+            // commits back towards the leader; where the two flows meet the same message also passes the
+            // prepares on, without the commit, which would otherwise be counted by both flows
+            if (!dests.empty()) {
+                if constexpr (requires { next->withhold_commits(); }) {
+                    next->withhold_commits();
+                }
+            }
+            dests.insert(dests.end(), toward.begin(), toward.end());
+        }
+        return dests;
+    }
+};
+
 int f;
+unsigned seed; // of the overlay and the peer orders, 0 for a random full mesh
+bool adapting; // fanout adapted to the redundancy of what is received
+
+// the same expander for every replica of a seed: the union of a few random Hamiltonian cycles, of degree
+// about log2 n, which keeps every group of replicas well connected to the rest
+std::vector<int> overlay_peers(int i, int n) {
+    int cycles = 2;
+    while ((1 << (2 * cycles)) < n) {
+        cycles++;
+    }
+    std::mt19937 random(::seed);
+    std::vector<int> cycle(n);
+    std::vector<int> peers;
+    for (int c = 0; c < cycles; c++) {
+        std::iota(cycle.begin(), cycle.end(), 0);
+        std::shuffle(cycle.begin(), cycle.end(), random);
+        int k = (int) (std::find(cycle.begin(), cycle.end(), i) - cycle.begin());
+        for (int peer : {cycle.at((k + 1) % n), cycle.at((k + n - 1) % n)}) {
+            if (peer != i && std::find(peers.begin(), peers.end(), peer) == peers.end()) {
+                peers.push_back(peer);
+            }
+        }
+    }
+    return peers;
+}
 
-class gossip : public pattern {
+// peers a gossiping replica goes through, in the order it does
+std::vector<int> gossip_peers(information &info) {
+    if (::seed == 0) {
+        std::vector<int> peers(info.replicas);
+        std::shuffle(peers.begin(), peers.end(), std::random_device());
+        return peers;
+    }
+    std::vector<int> peers = overlay_peers(info.i, 3*::t + 1);
+    std::shuffle(peers.begin(), peers.end(), std::mt19937(::seed + info.i + 1));
+    return peers;
+}
+
+// fanout lowered while most of what arrives is already known, and raised back towards the configured one
+// while most is new; never below 2, with which gossip stops reaching every replica
+class fanout_control {
 public:
-    std::vector<int> permutation;
+    static constexpr double WEIGHT = 0.25;
+    static constexpr double HIGH = 0.5;
+    static constexpr double LOW = 0.2;
+
     int fanout;
+    int max;
+    int min;
+    double redundancy = (HIGH + LOW) / 2;
+
+    fanout_control(int fanout, int peers) : fanout(std::min(fanout, peers)), max(this->fanout), min(std::min(2, this->fanout)) {}
+
+    void observe(bool fresh) {
+        if (!::adapting) {
+            return;
+        }
+        redundancy = WEIGHT * (fresh ? 0 : 1) + (1 - WEIGHT) * redundancy;
+        if (redundancy > HIGH && fanout > min) {
+            fanout--;
+            redundancy = (HIGH + LOW) / 2;
+        }
+        else if (redundancy < LOW && fanout < max) {
+            fanout++;
+            redundancy = (HIGH + LOW) / 2;
+        }
+    }
+};
+
+template <class SIGS>
+class gossip final : public pattern<SIGS> {
+public:
+    std::vector<int> permutation;
+    fanout_control control;
 
-    explicit gossip(information info) : pattern(info), permutation(info.replicas), fanout(::f) {
-        std::shuffle(permutation.begin(), permutation.end(), std::random_device());
+    explicit gossip(information info) : pattern<SIGS>(info), permutation(gossip_peers(info)), control(::f, (int) permutation.size()) {}
+
+    void observe(bool fresh) {
+        control.observe(fresh);
     }
 
-    std::vector<int> destinations(signatures *next) override {
+    std::vector<int> destinations(SIGS *next) {
+        int fanout = control.fanout;
         std::vector<int> dests (permutation.begin(), permutation.begin() + fanout);
         std::rotate(permutation.begin(), permutation.begin() + fanout, permutation.end());
         return dests;
     }
 };
 
+// push-pull gossip: every message is stamped with its sender and the signers it had (see message::from).
+// A replica pushes to peers that may lack what it has: neither the last stamp of the peer nor its own
+// state when it last sent to the peer covers the current one (a union of the two could claim more than
+// the peer holds, aggregates of -sP and -sX only merge over disjoint signers). Until prepared, peers whose
+// prepare is still missing go first. A replica answers a peer that lacks a quorum it has with its state,
+// and asks a peer that had a quorum it still misses with its stamp alone. Peers known to have the commit
+// certificate are neither pushed to nor answered, so the gossip stops once they all have it
+template <class SIGS>
+class push_pull_gossip final : public pattern<SIGS> {
+public:
+    using pattern<SIGS>::info;
+
+    std::vector<int> permutation;
+    fanout_control control;
+    std::vector<std::optional<digest>> known; // last stamp of each peer
+    std::vector<std::optional<digest>> sent; // own digest when last sent to the peer
+    std::vector<std::optional<digest>> asked; // own digest when the peer was last asked
+    std::vector<int> requests; // peers to ask, taken by the replica
+    bool committed = false; // the certificate went out to the peers heard of
+
+    explicit push_pull_gossip(information info) : pattern<SIGS>(info), permutation(gossip_peers(info)), control(::f, (int) permutation.size()),
+            known(3*::t + 1), sent(3*::t + 1), asked(3*::t + 1) {}
+
+    void observe(bool fresh) {
+        control.observe(fresh);
+    }
+
+    void heard(int peer, const digest &d) {
+        known.at(peer) = d;
+    }
+
+    static bool has(const std::optional<digest> &d, const digest &now) {
+        return d.has_value() && (d->committed() || d->covers(now));
+    }
+
+    bool lacks(int peer, const digest &now) {
+        return !has(known.at(peer), now) && !has(sent.at(peer), now);
+    }
+
+    std::vector<int> destinations(SIGS *next) {
+        int fanout = control.fanout;
+        digest now = digest::of(next);
+        std::vector<int> dests;
+        // peers whose own signature is still missing are behind, they go first
+        for (int pass = 0; pass < 2 && (int) dests.size() < fanout; pass++) {
+            for (size_t k = 0; k < permutation.size() && (int) dests.size() < fanout; k++) {
+                int peer = permutation.at(k);
+                bool behind = !next->prepared() && peer != 0 && !now.prepares.test(peer);
+                if ((pass == 0) == behind && lacks(peer, now)) {
+                    sent.at(peer) = now;
+                    dests.push_back(peer);
+                }
+            }
+        }
+        std::rotate(permutation.begin(), permutation.begin() + fanout, permutation.end());
+        if (now.committed() && !committed) {
+            // the certificate also goes to every peer last heard of without it: with no pushes left, nothing
+            // else would reach one that is still missing a commit
+            committed = true;
+            for (int peer = 0; peer < (int) known.size(); peer++) {
+                if (known.at(peer).has_value() && lacks(peer, now) && std::find(dests.begin(), dests.end(), peer) == dests.end()) {
+                    sent.at(peer) = now;
+                    dests.push_back(peer);
+                }
+            }
+        }
+        return dests;
+    }
+
+    // a quorum the replica with digest a has and the one with digest b lacks, prepare or commit
+    static bool ahead(const digest &a, const digest &b) {
+        return (a.committed() && !b.committed()) || (a.prepares.count() >= 2*::t && b.prepares.count() < 2*::t);
+    }
+
+    // after a message from peer, whose stamp was d: the peer is answered with this replica's state (added
+    // to dests, sent anyway) if it lacks a quorum this replica has, and asked for its own the other way
+    // round, when the message did not bring it; any other difference is left to the pushes, answering
+    // every one would about double the messages
+    void answer(SIGS *next, int peer, const digest &d, std::vector<int> &dests) {
+        digest now = digest::of(next);
+        if (ahead(now, d) && std::find(dests.begin(), dests.end(), peer) == dests.end() && lacks(peer, now)) {
+            sent.at(peer) = now;
+            dests.push_back(peer);
+        }
+        if (ahead(d, now) && (!asked.at(peer).has_value() || !asked.at(peer)->covers(now))) {
+            asked.at(peer) = now;
+            requests.push_back(peer);
+        }
+    }
+};
+
+#define GROUP_TIMEOUT 100 // ms after which a head forwards what its group has, short of the quorum
+
+// what the grouped patterns check of the last sent state
+class group_snapshot {
+public:
+    bool own_prepare;
+    bool own_commit;
+    int group_prepares; // of the group, head included, the leader counting as prepared
+    int group_commits;
+    bool prepared;
+    bool committed;
+};
+
+// replicas split into groups, each with a head (its lowest replica, so the leader heads its own):
+// members only talk to their head, heads aggregate their group before anything crosses groups
+template <class SIGS>
+class grouped : public pattern<SIGS> {
+public:
+    using pattern<SIGS>::info;
+
+    std::optional<group_snapshot> last;
+    int head;
+    std::vector<int> members; // of the group, without the head
+    std::vector<int> heads; // of the other groups
+    int quorum; // of the group, as 2t+1 of 3t+1 replicas: up to a third of it may stay silent
+    std::chrono::steady_clock::time_point started;
+    int forwarded_prepares = 0; // group signatures in the last message up
+    int forwarded_commits = 0;
+
+    explicit grouped(information &info) : pattern<SIGS>(info), head(head_of(info.i)), started(std::chrono::steady_clock::now()) {
+        int n = 3*::t + 1;
+        for (int i = 0; i < n; i++) {
+            if (head_of(i) == i && i != head) {
+                heads.push_back(i);
+            }
+            if (head_of(i) == head && i != head) {
+                members.push_back(i);
+            }
+        }
+        int size = (int) members.size() + 1;
+        quorum = size - (size - 1) / 3;
+    }
+
+    group_snapshot snapshot_of(SIGS *next) {
+        group_snapshot now {next->contains_prepare(info.i), next->contains_commit(info.i), 0, 0, next->prepared(), next->committed()};
+        if (info.i == head) {
+            now.group_prepares = info.i == 0 || now.own_prepare;
+            now.group_commits = now.own_commit;
+            for (int i : members) {
+                now.group_prepares += i == 0 || next->contains_prepare(i);
+                now.group_commits += next->contains_commit(i);
+            }
+        }
+        return now;
+    }
+
+    // the group's quorum, or all of it, is reached with this step
+    bool reached(int before, int now) {
+        int size = (int) members.size() + 1;
+        return (before < quorum && now >= quorum) || (before < size && now >= size);
+    }
+
+    // heads are sent a group's aggregate once its quorum is in, again once the whole group is, and after
+    // GROUP_TIMEOUT whatever came since: silent members do not hold their group back
+    std::vector<int> group_destinations(SIGS *next, const std::vector<int> &uplink, const std::vector<int> &downlink) {
+        group_snapshot now = snapshot_of(next);
+        bool first = !last.has_value();
+        group_snapshot before = first ? group_snapshot {} : last.value();
+        last = now;
+
+        std::vector<int> dests;
+        if (info.i != head) {
+            if (first || (!before.own_prepare && now.own_prepare) || (!before.own_commit && now.own_commit)) {
+                dests.push_back(head);
+            }
+            return dests;
+        }
+
+        if (first) {
+            // pre-prepare
+            dests.insert(dests.end(), members.begin(), members.end());
+            if (info.i == 0) {
+                dests.insert(dests.end(), heads.begin(), heads.end());
+            }
+        }
+        bool late = std::chrono::steady_clock::now() - started >= std::chrono::milliseconds(GROUP_TIMEOUT)
+                && (now.group_prepares > forwarded_prepares || now.group_commits > forwarded_commits);
+        // a committed head stops receiving, so its certificate goes up even if the group is not complete
+        if (reached(before.group_prepares, now.group_prepares) || reached(before.group_commits, now.group_commits) || (!before.committed && now.committed) || late) {
+            dests.insert(dests.end(), uplink.begin(), uplink.end());
+            forwarded_prepares = now.group_prepares;
+            forwarded_commits = now.group_commits;
+            if constexpr (requires { next->forward_group(); }) {
+                if (!uplink.empty()) {
+                    next->forward_group(); // the message only carries what the group has not sent up yet
+                }
+            }
+        }
+        if ((!before.prepared && now.prepared) || (!before.committed && now.committed)) {
+            dests.insert(dests.end(), downlink.begin(), downlink.end());
+        }
+        std::sort(dests.begin(), dests.end());
+        dests.erase(std::unique(dests.begin(), dests.end()), dests.end());
+        return dests;
+    }
+};
+
+// groups are regions: heads exchange one aggregate per region and phase over the wide-area links
+template <class SIGS>
+class hierarchical final : public grouped<SIGS> {
+public:
+    using grouped<SIGS>::heads;
+    using grouped<SIGS>::members;
+
+    explicit hierarchical(information info) : grouped<SIGS>(info) {}
+
+    std::vector<int> destinations(SIGS *next) {
+        return this->group_destinations(next, heads, members);
+    }
+};
+
+// centralized with k collectors: groups are slices whose heads send their partial aggregates to the
+// leader, which sends the certificates back through them; messages stay linear in n, without a single
+// replica receiving from all the others
+template <class SIGS>
+class sharded final : public grouped<SIGS> {
+public:
+    using grouped<SIGS>::info;
+    using grouped<SIGS>::heads;
+    using grouped<SIGS>::members;
+
+    std::vector<int> uplink;
+    std::vector<int> downlink;
+
+    explicit sharded(information info) : grouped<SIGS>(info), downlink(members) {
+        if (info.i == 0) {
+            downlink.insert(downlink.end(), heads.begin(), heads.end());
+        }
+        else {
+            uplink.push_back(0);
+        }
+    }
+
+    std::vector<int> destinations(SIGS *next) {
+        return this->group_destinations(next, uplink, downlink);
+    }
+};
+
 #endif
@@ -0,0 +1,96 @@
+#ifndef PATTERN_SWITCH_H
+#define PATTERN_SWITCH_H
+
+#include <vector>
+
+#include "arguments.h"
+#include "progress.h"
+
+// chooses the communication pattern of the next instance from what the previous ones measured;
+// the switch happens between instances, once every replica has committed, so no message of one
+// pattern is ever handled by another
+class pattern_switch {
+public:
+    static constexpr int EXPLORE = 16; // instances between two tries of the stalest other pattern
+    static constexpr double WEIGHT = 0.5;
+
+    std::vector<int> patterns {BROADCAST, CENTRALIZED, RING, BIRING, GOSSIP, DIGESTGOSSIP};
+    std::vector<phase_latency> measured; // moving averages of each pattern, ms and bytes
+    std::vector<bool> tried;
+    std::vector<int> last_tried;
+    int instance = 0;
+
+    pattern_switch() {
+        measured.resize(patterns.size());
+        tried.resize(patterns.size(), false);
+        last_tried.resize(patterns.size(), 0);
+    }
+
+    // hierarchical and sharded, over the regions given with -pH or -pC=k
+    void add_grouped() {
+        for (int patt : {HIERARCHICAL, SHARDED}) {
+            patterns.push_back(patt);
+            measured.emplace_back();
+            tried.push_back(false);
+            last_tried.push_back(0);
+        }
+    }
+
+    int index_of(int patt) const {
+        for (int k = 0; k < (int) patterns.size(); k++) {
+            if (patterns.at(k) == patt) {
+                return k;
+            }
+        }
+        return -1;
+    }
+
+    // estimated duration of an instance: the latency of its phases plus the time its bytes take at ::bandwidth
+    double cost(int k) const {
+        const phase_latency &m = measured.at(k);
+        double millis = m.prepare + m.commit;
+        return ::bandwidth > 0 ? millis + (double) m.bytes / ::bandwidth : millis;
+    }
+
+    void record(int patt, const phase_latency &latency) {
+        int k = index_of(patt);
+        phase_latency &m = measured.at(k);
+        if (!tried.at(k)) {
+            m = latency;
+        }
+        else {
+            m.prepare = WEIGHT * latency.prepare + (1 - WEIGHT) * m.prepare;
+            m.commit = WEIGHT * latency.commit + (1 - WEIGHT) * m.commit;
+            m.bytes = (long) (WEIGHT * latency.bytes + (1 - WEIGHT) * m.bytes);
+        }
+        tried.at(k) = true;
+        last_tried.at(k) = ++instance;
+    }
+
+    int next() {
+        // every pattern once first
+        for (int k = 0; k < (int) patterns.size(); k++) {
+            if (!tried.at(k)) {
+                return patterns.at(k);
+            }
+        }
+
+        int best = 0;
+        int stalest = 0;
+        for (int k = 1; k < (int) patterns.size(); k++) {
+            if (cost(k) < cost(best)) {
+                best = k;
+            }
+            if (last_tried.at(k) < last_tried.at(stalest)) {
+                stalest = k;
+            }
+        }
+        // conditions change, so the others are measured again from time to time
+        if (instance - last_tried.at(stalest) >= EXPLORE) {
+            return patterns.at(stalest);
+        }
+        return patterns.at(best);
+    }
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+
+// when a replica became prepared and committed (steady clock ns, 0 until then) and the bytes it sent
+class replica_progress {
+public:
+    int64_t prepared;
+    int64_t committed;
+    long bytes;
+};
+
+// latency of each phase of an instance, from the leader's pre-prepare until some replica is prepared, then
+// until the last one committed, so neither forking the replicas nor their exit is counted
+class phase_latency {
+public:
+    double prepare = 0; // ms
+    double commit = 0;
+    long bytes = 0;
+};
+
+// progress of every replica in the instance being run (-pA), in a shared anonymous mapping made before
+// forking so the replica processes of -mS, -mM and -mB fill it in for the parent; each replica only writes
+// its own entry, the leader also the start
+class instance_progress {
+public:
+    int n = 0;
+    size_t size = 0;
+    uint8_t *region = nullptr;
+
+    ~instance_progress() {
+        if (region != nullptr) {
+            munmap(region, size);
+        }
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t * started() {
+        return (int64_t *) region;
+    }
+
+    replica_progress * replicas() {
+        return (replica_progress *) (region + sizeof(replica_progress));
+    }
+
+    void begin(int k) {
+        if (k != n && region != nullptr) {
+            munmap(region, size);
+            region = nullptr;
+        }
+        if (region == nullptr) {
+            // the start, padded to an entry, then one entry per replica
+            n = k;
+            size = (n + 1) * sizeof(replica_progress);
+            void *mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            region = mapped == MAP_FAILED ? nullptr : (uint8_t *) mapped;
+        }
+        if (region != nullptr) {
+            std::memset(region, 0, size);
+        }
+    }
+
+    void start() {
+        if (region != nullptr) {
+            *started() = now();
+        }
+    }
+
+    void reached(int i, bool prepared, bool committed) {
+        if (region == nullptr || i >= n) {
+            return;
+        }
+        replica_progress &p = replicas()[i];
+        if (prepared && p.prepared == 0) {
+            p.prepared = now();
+        }
+        if (committed && p.committed == 0) {
+            p.committed = now();
+        }
+    }
+
+    void sent(int i, long bytes) {
+        if (region != nullptr && i < n) {
+            replicas()[i].bytes += bytes;
+        }
+    }
+
+    phase_latency measured() {
+        phase_latency latency;
+        if (region == nullptr) {
+            return latency;
+        }
+        int64_t prepared = 0;
+        int64_t committed = 0;
+        for (int i = 0; i < n; i++) {
+            const replica_progress &p = replicas()[i];
+            if (p.prepared != 0) {
+                prepared = prepared == 0 ? p.prepared : std::min(prepared, p.prepared);
+            }
+            committed = std::max(committed, p.committed);
+            latency.bytes += p.bytes;
+        }
+        if (prepared != 0) {
+            latency.prepare = (double) (prepared - *started()) / 1e6;
+            latency.commit = (double) (std::max(committed, prepared) - prepared) / 1e6;
+        }
+        return latency;
+    }
+};
+
+instance_progress progress;
+
+#endif
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trace.h"
+
+// re-drives the steps of a trace (-T=<file>) over another link model: every replica handles the same
+// messages in the same order, with the cpu time recorded for each step, so no crypto is recomputed
+double latency = 0; // ms per message
+double bandwidth = 0; // bytes/ms of each replica's uplink, copies of a message leave one after the other
+double speedup = 1; // recorded cpu time divided by this
+
+class instance_replay {
+public:
+    int n;
+    std::vector<double> free; // ms at which each replica is done with its previous step
+    std::vector<double> uplink; // ms at which each replica's uplink is done with its previous copies
+    std::unordered_map<uint64_t, double> arrivals; // (step, destination) -> ms
+    std::vector<double> recorded_commits; // ms at which each replica committed, as recorded
+    std::vector<double> replayed_commits;
+    long messages = 0;
+    long bytes = 0;
+    int step = 0;
+
+    explicit instance_replay(int n) : n(n), free(n, 0), uplink(n, 0), recorded_commits(n, -1), replayed_commits(n, -1) {}
+
+    static uint64_t key(int step, int dest) {
+        return (uint64_t) step << 16 | dest;
+    }
+
+    void replay(const trace_step &s) {
+        double start = free.at(s.replica);
+        if (s.trigger >= 0) {
+            auto it = arrivals.find(key(s.trigger, s.replica));
+            if (it != arrivals.end()) {
+                start = std::max(start, it->second);
+                arrivals.erase(it);
+            }
+        }
+        double done = start + s.cpu / 1e6 / speedup;
+        free.at(s.replica) = done;
+
+        double sent = std::max(done, uplink.at(s.replica));
+        for (int dest : s.dests) {
+            if (bandwidth > 0) {
+                sent += s.bytes / bandwidth;
+            }
+            arrivals[key(step, dest)] = sent + latency;
+        }
+        if (!s.dests.empty()) {
+            uplink.at(s.replica) = sent;
+        }
+        messages += (long) s.dests.size();
+        bytes += (long) s.bytes * (long) s.dests.size();
+
+        if ((s.state & trace_step::COMMITTED) && recorded_commits.at(s.replica) < 0) {
+            recorded_commits.at(s.replica) = (s.time + s.cpu) / 1e6;
+            replayed_commits.at(s.replica) = done;
+        }
+        step++;
+    }
+
+    // ms until the k-th replica committed, -1 if fewer did
+    static double until(std::vector<double> commits, int k) {
+        commits.erase(std::remove(commits.begin(), commits.end(), -1.0), commits.end());
+        if ((int) commits.size() < k) {
+            return -1;
+        }
+        std::sort(commits.begin(), commits.end());
+        return commits.at(k - 1);
+    }
+
+    void report(int instance) {
+        int quorum = n - (n - 1) / 3;
+        std::cout << instance << "," << n << "," << messages << "," << bytes
+                  << "," << until(recorded_commits, quorum) << "," << until(recorded_commits, n)
+                  << "," << until(replayed_commits, quorum) << "," << until(replayed_commits, n) << std::endl;
+    }
+};
+
+int main(int argc, const char* argv[]) {
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            switch (argv[i][1]) {
+                case 'l':
+                    // argv[i][2] == '='
+                    // one-way latency of every link, ms
+                    ::latency = std::stod(argv[i] + 3);
+                    break;
+                case 'b':
+                    // argv[i][2] == '='
+                    // uplink bandwidth, bytes/ms (0 is unlimited)
+                    ::bandwidth = std::stod(argv[i] + 3);
+                    break;
+                case 's':
+                    // argv[i][2] == '='
+                    // cpu speedup over the traced run
+                    ::speedup = std::stod(argv[i] + 3);
+                    break;
+            }
+        }
+        else {
+            path = argv[i];
+        }
+    }
+
+    trace_reader reader;
+    if (!reader.open(path)) {
+        std::cerr << "usage: replay <trace> [-l=<ms>] [-b=<bytes/ms>] [-s=<speedup>]" << std::endl;
+        return 1;
+    }
+
+    // instance, replicas, messages, bytes, recorded quorum and all committed ms, replayed quorum and all committed ms
+    std::optional<instance_replay> current;
+    int instance = 0;
+    bool header;
+    int n;
+    trace_step s;
+    while (reader.next(header, n, s)) {
+        if (header) {
+            if (current.has_value()) {
+                current->report(instance++);
+            }
+            current.emplace(n);
+        }
+        else if (current.has_value()) {
+            current->replay(s);
+        }
+    }
+    if (current.has_value()) {
+        current->report(instance);
+    }
+}
@@ -1,60 +1,100 @@
 #ifndef REPLICA_H
 #define REPLICA_H
 
+#include <optional>
 #include <queue>
+#include <utility>
 #include <vector>
 
 #include "serialized_signatures/serialized_signatures.h"
-#include "signature_schemes/signature_scheme.h"
+#include "counters.h"
 #include "information.h"
+#include "message.h"
 #include "state_machine_replication.h"
 #include "pattern.h"
+#include "progress.h"
+#include "timeline.h"
 
-pattern * create_pattern(information &info) {
-    switch (::patt) {
-        case BROADCAST:
-            return new broadcast(info);
-        case CENTRALIZED:
-            return new centralized(info);
-        case RING:
-            return new ring(info);
-        case GOSSIP:
-            return new gossip(info);
-        default:
-            return nullptr;
-    }
-}
-
+template <class SCHEME, template <class> class PATTERN>
 class replica {
 public:
-    state_machine_replication smr;
-    std::queue<serialized_signatures *> inbox;
-    pattern *patt;
+    state_machine_replication<SCHEME> smr;
+    std::queue<message_ptr> inbox;
+    PATTERN<typename SCHEME::signatures_type> patt;
+
+    // the pattern pulls: messages are stamped with their sender and its signers, see message::from
+    static constexpr bool pulling = requires (PATTERN<typename SCHEME::signatures_type> p, int peer, const digest &d) { p.heard(peer, d); };
+
+    replica(information info, SCHEME *sig_scm) : smr(info, sig_scm), patt(info) {}
 
-    replica(information info, signature_scheme *sig_scm) : smr(state_machine_replication(info, sig_scm)), patt(
-            create_pattern(info)) {}
+    // phase a step works on, from the state before it: the leader starts in pre-prepare, the others are
+    // there until they sign their prepare
+    int phase() {
+        if (smr.sigs->prepared()) {
+            return phase_counters::COMMIT;
+        }
+        if (smr.info.i != 0 && !smr.sigs->contains_prepare(smr.info.i)) {
+            return phase_counters::PREPREPARE;
+        }
+        return phase_counters::PREPARE;
+    }
 
     std::vector<int> start() {
+        counted c(smr.info.i, phase_counters::PREPREPARE);
         smr.create_preprepare();
-        return patt->destinations(smr.sigs);
+        ::progress.start();
+        span s("destinations", smr.info.i);
+        return patt.destinations(smr.sigs);
     }
 
     std::vector<int> next() {
-        serialized_signatures *msg = inbox.front();
+        message_ptr msg = inbox.front();
         inbox.pop();
 
-        if (smr.receive(msg)) {
-            return patt->destinations(smr.sigs);
+        counted c(smr.info.i, phase());
+        if constexpr (pulling) {
+            patt.heard(msg->from->sender, msg->from->known);
+        }
+        // a request carries no signatures
+        bool fresh = msg->ser_sigs != nullptr && smr.receive(msg->ser_sigs.get());
+        ::progress.reached(smr.info.i, smr.sigs->prepared(), smr.sigs->committed());
+        if constexpr (requires { patt.observe(fresh); }) {
+            patt.observe(fresh);
+        }
+        std::vector<int> dests;
+        if (fresh) {
+            span s("destinations", smr.info.i);
+            dests = patt.destinations(smr.sigs);
+        }
+        if constexpr (pulling) {
+            patt.answer(smr.sigs, msg->from->sender, msg->from->known, dests);
+        }
+        return dests;
+    }
+
+    // peers to ask for their state after the last step, with a stamp alone
+    std::vector<int> requests() {
+        if constexpr (pulling) {
+            return std::exchange(patt.requests, {});
         }
         return {};
     }
 
+    // the stamp of what this replica sends, if the pattern pulls
+    std::optional<stamp> stamped() {
+        if constexpr (pulling) {
+            return stamp {smr.info.i, digest::of(smr.sigs)};
+        }
+        return std::nullopt;
+    }
+
     serialized_signatures * send() {
+        counted c(smr.info.i, phase());
         return smr.ser_sigs();
     }
 
-    void buffer(serialized_signatures *msg) {
-        inbox.push(msg);
+    void buffer(message_ptr msg) {
+        inbox.push(std::move(msg));
     }
 
     bool end() {
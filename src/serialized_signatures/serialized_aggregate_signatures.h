@@ -4,11 +4,13 @@
 #include <optional>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "../l_tree.h"
 #include "serialized_signatures.h"
+#include "wire.h"
 
-class serialized_aggregate_signatures : public serialized_signatures {
+class serialized_aggregate_signatures final : public serialized_signatures {
 public:
     std::optional<uint8_t *> ser_agg_sig;
     std::optional<l_tree<std::string>> agg_order;
@@ -33,6 +35,63 @@ public:
         }
         return length;
     }
+
+    void encode(std::vector<uint8_t> &buf) override {
+        wire_writer w(buf);
+        w.put_sig(ser_agg_sig);
+        w.put_tree(agg_order);
+        w.put_ids(prepares);
+        w.put_ids(commits);
+    }
+
+    // leaves are PP, P<i> or C<i> for a replica i of the cluster, the P and C ones exactly the prepares and
+    // commits, and no inner node is empty
+    static bool valid_order(const l_tree<std::string> &order, const std::unordered_set<int> &prepares, const std::unordered_set<int> &commits) {
+        std::unordered_set<int> prepare_leaves;
+        std::unordered_set<int> commit_leaves;
+        std::vector<const l_tree<std::string> *> stack = {&order};
+        while (!stack.empty()) {
+            const l_tree<std::string> *node = stack.back();
+            stack.pop_back();
+            if (!node->is_leaf()) {
+                if (node->children.empty()) {
+                    return false;
+                }
+                for (const l_tree<std::string> &child : node->children) {
+                    stack.push_back(&child);
+                }
+                continue;
+            }
+            const std::string &value = node->value.value();
+            if (value == "PP") {
+                continue;
+            }
+            if (value.size() < 2 || value.size() > 6 || (value.at(0) != 'P' && value.at(0) != 'C')
+                || value.find_first_not_of("0123456789", 1) != std::string::npos || std::stoi(value.substr(1)) >= 3*::t + 1) {
+                return false;
+            }
+            (value.at(0) == 'P' ? prepare_leaves : commit_leaves).insert(std::stoi(value.substr(1)));
+        }
+        return prepare_leaves == prepares && commit_leaves == commits;
+    }
+
+    static serialized_aggregate_signatures * decode(const uint8_t *data, size_t size) {
+        wire_reader r(data, size);
+        auto *ser = new serialized_aggregate_signatures();
+        ser->ser_agg_sig = r.get_sig();
+        ser->agg_order = r.get_optional_tree<std::string>();
+        ser->prepares = r.get_ids();
+        ser->commits = r.get_ids();
+        // the signature and its order come together, and signers only with them
+        bool consistent = ser->ser_agg_sig.has_value() == ser->agg_order.has_value()
+            && (ser->agg_order.has_value() ? valid_order(ser->agg_order.value(), ser->prepares, ser->commits) : ser->prepares.empty() && ser->commits.empty());
+        if (!r.done() || !consistent) {
+            delete ser;
+            return nullptr;
+        }
+        ser->storage = r.storage;
+        return ser;
+    }
 };
 
 #endif
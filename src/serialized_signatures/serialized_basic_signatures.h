@@ -6,8 +6,9 @@
 #include <map>
 
 #include "serialized_signatures.h"
+#include "wire.h"
 
-class serialized_basic_signatures : public serialized_signatures {
+class serialized_basic_signatures final : public serialized_signatures {
 public:
     std::optional<uint8_t *> ser_preprepare_sig;
     std::map<int, uint8_t *> ser_prepare_sigs;
@@ -49,6 +50,27 @@ public:
         }
         return length;
     }
+
+    void encode(std::vector<uint8_t> &buf) override {
+        wire_writer w(buf);
+        w.put_sig(ser_preprepare_sig);
+        w.put_sigs(ser_prepare_sigs);
+        w.put_sigs(ser_commit_sigs);
+    }
+
+    static serialized_basic_signatures * decode(const uint8_t *data, size_t size) {
+        wire_reader r(data, size);
+        auto *ser = new serialized_basic_signatures();
+        ser->ser_preprepare_sig = r.get_sig();
+        ser->ser_prepare_sigs = r.get_sigs();
+        ser->ser_commit_sigs = r.get_sigs();
+        if (!r.done()) {
+            delete ser;
+            return nullptr;
+        }
+        ser->storage = r.storage;
+        return ser;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef SERIALIZED_MOCK_SIGNATURES_H
+#define SERIALIZED_MOCK_SIGNATURES_H
+
+#include <optional>
+
+#include "../bitmap.h"
+#include "serialized_signatures.h"
+#include "wire.h"
+
+// signer sets only; length() still counts the aggregates a real multi-signature would carry
+class serialized_mock_signatures final : public serialized_signatures {
+public:
+    bool preprepare = false;
+    std::optional<bitmap> prepares;
+    std::optional<bitmap> commits;
+
+    int length() override {
+        int n = 3*::t + 1;
+        int length = 0;
+        if (preprepare) {
+            length += bls::InsecureSignature::SIGNATURE_SIZE;
+        }
+        if (prepares.has_value()) {
+            length += bls::InsecureSignature::SIGNATURE_SIZE;
+            length += bitmap::length(n);
+        }
+        if (commits.has_value()) {
+            length += bls::InsecureSignature::SIGNATURE_SIZE;
+            length += bitmap::length(n);
+        }
+        return length;
+    }
+
+    void encode(std::vector<uint8_t> &buf) override {
+        wire_writer w(buf);
+        int n = 3*::t + 1;
+        w.put_u8(preprepare | prepares.has_value() << 1 | commits.has_value() << 2);
+        if (prepares.has_value()) {
+            w.put_bitmap(prepares.value(), n);
+        }
+        if (commits.has_value()) {
+            w.put_bitmap(commits.value(), n);
+        }
+    }
+
+    static serialized_mock_signatures * decode(const uint8_t *data, size_t size) {
+        wire_reader r(data, size);
+        auto *ser = new serialized_mock_signatures();
+        int n = 3*::t + 1;
+        uint8_t flags = r.get_u8();
+        ser->preprepare = flags & 1;
+        if (flags & 2) {
+            ser->prepares = r.get_bitmap(n);
+        }
+        if (flags & 4) {
+            ser->commits = r.get_bitmap(n);
+        }
+        if (!r.done()) {
+            delete ser;
+            return nullptr;
+        }
+        ser->storage = r.storage;
+        return ser;
+    }
+};
+
+#endif
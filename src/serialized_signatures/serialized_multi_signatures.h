@@ -6,8 +6,9 @@
 
 #include "../l_tree.h"
 #include "serialized_signatures.h"
+#include "wire.h"
 
-class serialized_multi_signatures : public serialized_signatures {
+class serialized_multi_signatures final : public serialized_signatures {
 public:
     std::optional<uint8_t *> ser_preprepare_sig;
 
@@ -64,6 +65,62 @@ public:
         }
         return length;
     }
+
+    void encode(std::vector<uint8_t> &buf) override {
+        wire_writer w(buf);
+        w.put_sig(ser_preprepare_sig);
+        w.put_sig(ser_prepare_multisig);
+        w.put_tree(prepares_order);
+        w.put_ids(prepares);
+        w.put_sig(ser_commit_multisig);
+        w.put_tree(commits_order);
+        w.put_ids(commits);
+    }
+
+    // a multisig comes with its order tree, whose leaves are exactly its signers, and no inner node is empty
+    static bool consistent(const std::optional<uint8_t *> &ser_multisig, const std::optional<l_tree<int>> &order, const std::unordered_set<int> &signers) {
+        if (ser_multisig.has_value() != order.has_value()) {
+            return false;
+        }
+        if (!order.has_value()) {
+            return signers.empty();
+        }
+        std::unordered_set<int> leaves;
+        std::vector<const l_tree<int> *> stack = {&order.value()};
+        while (!stack.empty()) {
+            const l_tree<int> *node = stack.back();
+            stack.pop_back();
+            if (node->is_leaf()) {
+                leaves.insert(node->value.value());
+            }
+            else if (node->children.empty()) {
+                return false;
+            }
+            for (const l_tree<int> &child : node->children) {
+                stack.push_back(&child);
+            }
+        }
+        return leaves == signers;
+    }
+
+    static serialized_multi_signatures * decode(const uint8_t *data, size_t size) {
+        wire_reader r(data, size);
+        auto *ser = new serialized_multi_signatures();
+        ser->ser_preprepare_sig = r.get_sig();
+        ser->ser_prepare_multisig = r.get_sig();
+        ser->prepares_order = r.get_optional_tree<int>();
+        ser->prepares = r.get_ids();
+        ser->ser_commit_multisig = r.get_sig();
+        ser->commits_order = r.get_optional_tree<int>();
+        ser->commits = r.get_ids();
+        if (!r.done() || !consistent(ser->ser_prepare_multisig, ser->prepares_order, ser->prepares)
+            || !consistent(ser->ser_commit_multisig, ser->commits_order, ser->commits)) {
+            delete ser;
+            return nullptr;
+        }
+        ser->storage = r.storage;
+        return ser;
+    }
 };
 
 #endif
@@ -0,0 +1,81 @@
+#ifndef SERIALIZED_POP_MULTI_SIGNATURES_H
+#define SERIALIZED_POP_MULTI_SIGNATURES_H
+
+#include <optional>
+
+#include "../bitmap.h"
+#include "serialized_signatures.h"
+#include "wire.h"
+
+class serialized_pop_multi_signatures final : public serialized_signatures {
+public:
+    std::optional<uint8_t *> ser_preprepare_sig;
+
+    std::optional<uint8_t *> ser_prepare_multisig;
+    bitmap prepares;
+
+    std::optional<uint8_t *> ser_commit_multisig;
+    bitmap commits;
+
+    void add_preprepare(uint8_t *ser_sig) {
+        ser_preprepare_sig = ser_sig;
+    }
+
+    void set_prepare_multisig(uint8_t *ser_multisig, const bitmap &new_prepares) {
+        ser_prepare_multisig = ser_multisig;
+        prepares = new_prepares;
+    }
+
+    void set_commit_multisig(uint8_t *ser_multisig, const bitmap &new_commits) {
+        ser_commit_multisig = ser_multisig;
+        commits = new_commits;
+    }
+
+    int length() override {
+        int n = 3*::t + 1;
+        int length = 0;
+        if (ser_preprepare_sig.has_value()) {
+            length += bls::InsecureSignature::SIGNATURE_SIZE;
+        }
+        if (ser_prepare_multisig.has_value()) {
+            length += bls::InsecureSignature::SIGNATURE_SIZE;
+            length += bitmap::length(n);
+        }
+        if (ser_commit_multisig.has_value()) {
+            length += bls::InsecureSignature::SIGNATURE_SIZE;
+            length += bitmap::length(n);
+        }
+        return length;
+    }
+
+    void encode(std::vector<uint8_t> &buf) override {
+        wire_writer w(buf);
+        int n = 3*::t + 1;
+        w.put_sig(ser_preprepare_sig);
+        w.put_sig(ser_prepare_multisig);
+        w.put_bitmap(prepares, n);
+        w.put_sig(ser_commit_multisig);
+        w.put_bitmap(commits, n);
+    }
+
+    static serialized_pop_multi_signatures * decode(const uint8_t *data, size_t size) {
+        wire_reader r(data, size);
+        auto *ser = new serialized_pop_multi_signatures();
+        int n = 3*::t + 1;
+        ser->ser_preprepare_sig = r.get_sig();
+        ser->ser_prepare_multisig = r.get_sig();
+        ser->prepares = r.get_bitmap(n);
+        ser->ser_commit_multisig = r.get_sig();
+        ser->commits = r.get_bitmap(n);
+        // a multisig comes with its signers, and signers only with one
+        if (!r.done() || ser->ser_prepare_multisig.has_value() == ser->prepares.empty()
+            || ser->ser_commit_multisig.has_value() == ser->commits.empty()) {
+            delete ser;
+            return nullptr;
+        }
+        ser->storage = r.storage;
+        return ser;
+    }
+};
+
+#endif
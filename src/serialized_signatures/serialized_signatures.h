@@ -1,9 +1,20 @@
 #ifndef SERIALIZED_SIGNATURES_H
 #define SERIALIZED_SIGNATURES_H
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 class serialized_signatures {
 public:
+    std::shared_ptr<uint8_t[]> storage; // bytes the signatures of a decoded message point into
+
     virtual int length() = 0;
+
+    // appends the wire form (see wire.h); each type has a matching static decode
+    virtual void encode(std::vector<uint8_t> &) = 0;
+
+    virtual ~serialized_signatures() = default;
 };
 
 #endif
\ No newline at end of file
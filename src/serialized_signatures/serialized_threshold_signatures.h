@@ -5,8 +5,9 @@
 #include <map>
 
 #include "serialized_signatures.h"
+#include "wire.h"
 
-class serialized_threshold_signatures : public serialized_signatures {
+class serialized_threshold_signatures final : public serialized_signatures {
 public:
     std::optional<uint8_t *> ser_preprepare_sig;
 
@@ -82,6 +83,31 @@ public:
         }
         return length;
     }
+
+    void encode(std::vector<uint8_t> &buf) override {
+        wire_writer w(buf);
+        w.put_sig(ser_preprepare_sig);
+        w.put_sig(ser_prepare_sig);
+        w.put_sigs(ser_prepare_shares);
+        w.put_sig(ser_commit_sig);
+        w.put_sigs(ser_commit_shares);
+    }
+
+    static serialized_threshold_signatures * decode(const uint8_t *data, size_t size) {
+        wire_reader r(data, size);
+        auto *ser = new serialized_threshold_signatures();
+        ser->ser_preprepare_sig = r.get_sig();
+        ser->ser_prepare_sig = r.get_sig();
+        ser->ser_prepare_shares = r.get_sigs();
+        ser->ser_commit_sig = r.get_sig();
+        ser->ser_commit_shares = r.get_sigs();
+        if (!r.done()) {
+            delete ser;
+            return nullptr;
+        }
+        ser->storage = r.storage;
+        return ser;
+    }
 };
 
 
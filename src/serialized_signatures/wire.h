@@ -0,0 +1,275 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <signature.hpp>
+
+#include "../arguments.h"
+#include "../bitmap.h"
+#include "../l_tree.h"
+
+// byte layout of serialized signatures on the wire: little-endian integers, replica ids as 16 bits,
+// signatures as their 96 compressed bytes, optional fields behind a presence byte, order trees in
+// pre-order (a tag byte, then a leaf value or a child count)
+class wire_writer {
+public:
+    static const int SIGNATURE_SIZE = bls::InsecureSignature::SIGNATURE_SIZE;
+
+    std::vector<uint8_t> &buf;
+
+    explicit wire_writer(std::vector<uint8_t> &buf) : buf(buf) {}
+
+    void put_u8(uint8_t value) {
+        buf.push_back(value);
+    }
+
+    void put_u16(uint16_t value) {
+        buf.push_back(value & 0xff);
+        buf.push_back(value >> 8);
+    }
+
+    void put_bytes(const uint8_t *bytes, size_t size) {
+        buf.insert(buf.end(), bytes, bytes + size);
+    }
+
+    void put_sig(const std::optional<uint8_t *> &ser_sig) {
+        put_u8(ser_sig.has_value());
+        if (ser_sig.has_value()) {
+            put_bytes(ser_sig.value(), SIGNATURE_SIZE);
+        }
+    }
+
+    void put_sigs(const std::map<int, uint8_t *> &ser_sigs) {
+        put_u16(ser_sigs.size());
+        for (const std::pair<const int, uint8_t *> &pair : ser_sigs) {
+            put_u16(pair.first);
+            put_bytes(pair.second, SIGNATURE_SIZE);
+        }
+    }
+
+    void put_ids(const std::unordered_set<int> &ids) {
+        put_u16(ids.size());
+        for (int i : ids) {
+            put_u16(i);
+        }
+    }
+
+    // fixed size for the cluster, i.e. bitmap::length(n) bytes
+    void put_bitmap(const bitmap &ids, int n) {
+        for (int b = 0; b < bitmap::length(n); b++) {
+            size_t w = b / 8;
+            put_u8(w < ids.words.size() ? (ids.words[w] >> (8 * (b % 8))) & 0xff : 0);
+        }
+    }
+
+    void put_value(int value) {
+        put_u16(value);
+    }
+
+    void put_value(const std::string &value) {
+        put_u16(value.size());
+        put_bytes((const uint8_t *) value.data(), value.size());
+    }
+
+    // merges deepen the trees by one level each, so they are walked with an explicit stack
+    template <class T>
+    void put_tree(const l_tree<T> &tree) {
+        std::vector<const l_tree<T> *> stack = {&tree};
+        while (!stack.empty()) {
+            const l_tree<T> *node = stack.back();
+            stack.pop_back();
+            if (node->value.has_value()) {
+                put_u8(0);
+                put_value(node->value.value());
+            }
+            else {
+                put_u8(1);
+                put_u16(node->children.size());
+                for (auto child = node->children.rbegin(); child != node->children.rend(); child++) {
+                    stack.push_back(&*child);
+                }
+            }
+        }
+    }
+
+    template <class T>
+    void put_tree(const std::optional<l_tree<T>> &tree) {
+        put_u8(tree.has_value());
+        if (tree.has_value()) {
+            put_tree(tree.value());
+        }
+    }
+};
+
+// reads what wire_writer wrote; any truncated or malformed field (or replica id out of the cluster) clears ok
+// and yields empty values; signatures point into storage, one copy of the payload that the decoded
+// serialized signatures own
+class wire_reader {
+public:
+    static const int SIGNATURE_SIZE = bls::InsecureSignature::SIGNATURE_SIZE;
+
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    bool ok;
+    std::shared_ptr<uint8_t[]> storage;
+
+    wire_reader(const uint8_t *data, size_t size) : data(data), size(size), pos(0), ok(true) {}
+
+    bool has(size_t bytes) {
+        ok = ok && size - pos >= bytes;
+        return ok;
+    }
+
+    // whole payload consumed without errors
+    bool done() const {
+        return ok && pos == size;
+    }
+
+    uint8_t get_u8() {
+        if (!has(1)) { return 0; }
+        return data[pos++];
+    }
+
+    uint16_t get_u16() {
+        if (!has(2)) { return 0; }
+        uint16_t value = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        return value;
+    }
+
+    uint16_t get_id() {
+        uint16_t i = get_u16();
+        ok = ok && i < 3*::t + 1;
+        return ok ? i : 0;
+    }
+
+    uint8_t * get_bytes(size_t bytes) {
+        if (!has(bytes)) { return nullptr; }
+        if (storage == nullptr) {
+            storage.reset(new uint8_t[size]);
+            std::memcpy(storage.get(), data, size);
+        }
+        uint8_t *bytes_at = storage.get() + pos;
+        pos += bytes;
+        return bytes_at;
+    }
+
+    std::optional<uint8_t *> get_sig() {
+        if (get_u8() == 0) { return std::nullopt; }
+        uint8_t *ser_sig = get_bytes(SIGNATURE_SIZE);
+        if (ser_sig == nullptr) { return std::nullopt; }
+        return ser_sig;
+    }
+
+    std::map<int, uint8_t *> get_sigs() {
+        std::map<int, uint8_t *> ser_sigs;
+        int count = get_u16();
+        for (int k = 0; k < count && ok; k++) {
+            int i = get_id();
+            uint8_t *ser_sig = get_bytes(SIGNATURE_SIZE);
+            if (ser_sig != nullptr) {
+                ser_sigs[i] = ser_sig;
+            }
+        }
+        return ser_sigs;
+    }
+
+    std::unordered_set<int> get_ids() {
+        std::unordered_set<int> ids;
+        int count = get_u16();
+        for (int k = 0; k < count && ok; k++) {
+            int i = get_id();
+            if (ok) {
+                ids.insert(i);
+            }
+        }
+        return ids;
+    }
+
+    bitmap get_bitmap(int n) {
+        bitmap ids;
+        if (!has(bitmap::length(n))) { return ids; }
+        for (int b = 0; b < bitmap::length(n); b++) {
+            uint8_t byte = data[pos++];
+            for (int bit = 0; bit < 8; bit++) {
+                if ((byte >> bit) & 1) {
+                    ok = ok && 8 * b + bit < n;
+                    ids.set(8 * b + bit);
+                }
+            }
+        }
+        return ids;
+    }
+
+    // int leaves are replica ids
+    void get_value(int &value) {
+        value = get_id();
+    }
+
+    void get_value(std::string &value) {
+        int length = get_u16();
+        if (!has(length)) { return; }
+        value.assign((const char *) data + pos, length);
+        pos += length;
+    }
+
+    // iterative like put_tree: the depth is only bounded by the payload, every node takes at least one byte
+    template <class T>
+    l_tree<T> get_tree() {
+        class frame {
+        public:
+            std::vector<l_tree<T>> children;
+            int left;
+        };
+        std::vector<frame> stack;
+        while (true) {
+            std::optional<l_tree<T>> node;
+            if (get_u8() == 0 || !ok) {
+                T value{};
+                get_value(value);
+                node.emplace(value);
+            }
+            else {
+                int count = get_u16();
+                ok = ok && (size_t) count <= size - pos;
+                if (count == 0 || !ok) {
+                    node.emplace(std::vector<l_tree<T>>());
+                }
+                else {
+                    stack.push_back({{}, count});
+                    continue;
+                }
+            }
+            // a finished node closes every parent it completes (all of them once ok is cleared)
+            while (!stack.empty()) {
+                frame &parent = stack.back();
+                parent.children.push_back(std::move(node.value()));
+                if (--parent.left > 0 && ok) {
+                    break;
+                }
+                node.emplace(std::move(parent.children));
+                stack.pop_back();
+            }
+            if (stack.empty()) {
+                return std::move(node.value());
+            }
+        }
+    }
+
+    template <class T>
+    std::optional<l_tree<T>> get_optional_tree() {
+        if (get_u8() == 0) { return std::nullopt; }
+        return get_tree<T>();
+    }
+};
+
+#endif
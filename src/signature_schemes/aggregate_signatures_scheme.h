@@ -2,6 +2,7 @@
 #define AGGREGATE_SIGNATURE_SCHEME_H
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <aggregationinfo.hpp>
@@ -12,14 +13,25 @@
 #include "../l_tree.h"
 #include "../serialized_signatures/serialized_aggregate_signatures.h"
 #include "../signatures/aggregate_signatures.h"
+#include "aggregated_public_keys.h"
+#include "prepared_keys.h"
 #include "signature_scheme.h"
 
-class aggregate_signatures_scheme : public signature_scheme {
+template <int EVAL, int VER>
+class aggregate_signatures_scheme final : public signature_scheme {
 public:
+    using signatures_type = aggregate_signatures<EVAL>;
+    using serialized_type = serialized_aggregate_signatures;
+
     bls::PrivateKey sk;
-    std::vector<bls::PublicKey> pks;
+    prepared_keys *pks;
+    aggregation_infos *infos;
+
+    aggregate_signatures_scheme(bls::PrivateKey &sk, prepared_keys *pks, aggregation_infos *infos) : sk(sk), pks(pks), infos(infos) {}
 
-    aggregate_signatures_scheme(bls::PrivateKey &sk, std::vector<bls::PublicKey> &pks) : sk(sk), pks(pks) {}
+    signatures_type * create_signatures() {
+        return new signatures_type();
+    }
 
     signature * sign_preprepare() override {
         uint8_t preprepare[1] = {0};
@@ -39,47 +51,39 @@ public:
         return new secure_signature(sig);
     }
 
-    bls::AggregationInfo merged_aggregation_info(l_tree<std::string> &order) {
-        if (order.is_leaf()) {
-            std::string value = order.value.value();
-            if (value == "PP") {
-                uint8_t preprepare[1] = {0};
-                return bls::AggregationInfo::FromMsg(pks.at(0), preprepare, sizeof(preprepare));
-            }
-            else if (value.at(0) == 'P') {
-                uint8_t prepare[1] = {1};
-                int i = std::stoi(value.substr(1, std::string::npos));
-                return bls::AggregationInfo::FromMsg(pks.at(i), prepare, sizeof(prepare));
-            }
-            else /*if (value.at(0) == 'C')*/ {
-                uint8_t commit[1] = {2};
-                int i = std::stoi(value.substr(1, std::string::npos));
-                return bls::AggregationInfo::FromMsg(pks.at(i), commit, sizeof(commit));
-            }
+    // only three distinct messages: aggregate each phase's (exponentiated) keys and pair once per phase
+    bool verify_by_phase(bls::Signature &aggsig, const std::string &order_key) {
+        std::vector<std::pair<int, bls::PublicKey>> keys;
+        if (!infos->phase_keys(order_key, *aggsig.GetAggregationInfo(), keys)) {
+            return false;
         }
-        else {
-            std::vector<bls::AggregationInfo> infos;
-            for (l_tree<std::string> child : order.children) {
-                infos.push_back(merged_aggregation_info(child));
-            }
-            return bls::AggregationInfo::MergeInfos(infos);
+
+        std::vector<const uint8_t *> hashes;
+        std::vector<bls::PublicKey> agg_pks;
+        for (std::pair<int, bls::PublicKey> &key : keys) {
+            hashes.push_back(pks->hash(key.first));
+            agg_pks.push_back(key.second);
         }
+        return aggsig.GetInsecureSig().Verify(hashes, agg_pks);
     }
 
     bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
-        auto own_sigs = (aggregate_signatures *) sigs;
-        auto rcvd_ser_sigs = (serialized_aggregate_signatures *) ser_sigs;
+        return verify(static_cast<signatures_type *>(sigs), static_cast<serialized_type *>(ser_sigs));
+    }
+
+    bool verify(signatures_type *own_sigs, serialized_type *rcvd_ser_sigs) {
 
-        aggregate_signatures new_rcvd_sigs;
+        signatures_type new_rcvd_sigs;
 
         /* if (!own_sigs->agg_sig.has_value() || ((!own_sigs->prepared() || !own_sigs->committed()) &&
                 (!own_sigs->containsall_prepares(rcvd_ser_sigs->prepares) || !own_sigs->containsall_commits(rcvd_ser_sigs->commits)))) { */
         if (!own_sigs->agg_sig.has_value() || (!own_sigs->prepared() && !own_sigs->containsall_prepares(rcvd_ser_sigs->prepares)) || (!own_sigs->committed() &&
                 !own_sigs->containsall_commits(rcvd_ser_sigs->commits))) {
 
-            bls::Signature aggsig = bls::Signature::FromBytes(rcvd_ser_sigs->ser_agg_sig.value(), merged_aggregation_info(rcvd_ser_sigs->agg_order.value()));
+            l_tree<std::string> &order = rcvd_ser_sigs->agg_order.value();
+            bls::Signature aggsig = bls::Signature::FromBytes(rcvd_ser_sigs->ser_agg_sig.value(), infos->merged_info(order));
 
-            if (!aggsig.Verify()) {
+            if (!verify_by_phase(aggsig, aggregation_infos::key(order))) {
                 return false;
             }
             new_rcvd_sigs.set_aggsig(aggsig, rcvd_ser_sigs->agg_order.value(), rcvd_ser_sigs->prepares, rcvd_ser_sigs->commits);
@@ -0,0 +1,233 @@
+#ifndef AGGREGATED_PUBLIC_KEYS_H
+#define AGGREGATED_PUBLIC_KEYS_H
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <aggregationinfo.hpp>
+#include <publickey.hpp>
+
+#include "../bitmap.h"
+#include "../l_tree.h"
+#include "prepared_keys.h"
+
+// bls::PublicKey::Aggregate is not associative (exponents depend on the aggregated set), so the
+// memo is keyed by the signers of each order subtree together with its merge shape; a subtree
+// built from known subtrees plus new signers only costs the top-level Aggregate
+class aggregated_public_keys {
+public:
+    static const int OPEN = -1;
+    static const int CLOSE = -2;
+
+    prepared_keys *pks;
+    std::map<std::vector<int>, bls::PublicKey> memo;
+    std::mutex lock;
+
+    explicit aggregated_public_keys(prepared_keys *pks) : pks(pks) {}
+
+    bls::PublicKey aggregated_pk(l_tree<int> &order) {
+        std::vector<int> key;
+        return aggregated_pk(order, key);
+    }
+
+    bls::PublicKey aggregated_pk(l_tree<int> &order, std::vector<int> &key) {
+        if (order.is_leaf()) {
+            int i = order.value.value();
+            key.push_back(i);
+            return pks->pk(i);
+        }
+
+        size_t begin = key.size();
+        key.push_back(OPEN);
+        std::vector<bls::PublicKey> agg_pks;
+        for (l_tree<int> &child : order.children) {
+            agg_pks.push_back(aggregated_pk(child, key));
+        }
+        key.push_back(CLOSE);
+
+        std::vector<int> subtree_key(key.begin() + begin, key.end());
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = memo.find(subtree_key);
+            if (it != memo.end()) {
+                return it->second;
+            }
+        }
+        bls::PublicKey agg_pk = bls::PublicKey::Aggregate(agg_pks);
+        std::lock_guard<std::mutex> guard(lock);
+        memo.emplace(subtree_key, agg_pk);
+        return agg_pk;
+    }
+};
+
+// proof-of-possession keys are aggregated insecurely, which is associative: keyed by signer bitmap and
+// extended from a known subset (e.g. the receiver's own signers) with the new signers only
+class pop_aggregated_public_keys {
+public:
+    prepared_keys *pks;
+    std::map<bitmap, bls::PublicKey> memo;
+    std::mutex lock;
+
+    explicit pop_aggregated_public_keys(prepared_keys *pks) : pks(pks) {}
+
+    bls::PublicKey aggregated_pk(const bitmap &signers, const bitmap &known) {
+        std::vector<bls::PublicKey> agg_pks;
+        std::vector<int> new_signers;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = memo.find(signers);
+            if (it != memo.end()) {
+                return it->second;
+            }
+
+            auto known_it = memo.end();
+            if (!known.empty() && signers.contains_all(known)) {
+                known_it = memo.find(known);
+            }
+            if (known_it != memo.end()) {
+                agg_pks.push_back(known_it->second);
+                new_signers = signers.minus(known);
+            }
+            else {
+                new_signers = signers.members();
+            }
+        }
+        for (int i : new_signers) {
+            agg_pks.push_back(pks->pk(i));
+        }
+
+        bls::PublicKey agg_pk = agg_pks.size() == 1 ? agg_pks.at(0) : bls::PublicKey::AggregateInsecure(agg_pks);
+        std::lock_guard<std::mutex> guard(lock);
+        memo.emplace(signers, agg_pk);
+        return agg_pk;
+    }
+};
+
+// relic big number freed with its scope
+class exponent {
+public:
+    bn_t value;
+
+    exponent() {
+        bn_null(value);
+        bn_new(value);
+    }
+
+    ~exponent() {
+        bn_free(value);
+    }
+
+    exponent(const exponent &) = delete;
+    exponent & operator=(const exponent &) = delete;
+};
+
+// secure aggregates carry their merge order: the merged aggregation info of each order subtree is memoized
+// like aggregated_public_keys (MergeInfos only runs for subtrees not seen before), and so are the exponentiated
+// and aggregated keys of each phase for a whole order, which cost one G1 scalar multiplication per signer
+class aggregation_infos {
+public:
+    prepared_keys *pks;
+    std::map<std::string, bls::AggregationInfo> infos;
+    std::map<std::string, std::vector<std::pair<int, bls::PublicKey>>> phase_pks;
+    std::mutex lock;
+
+    explicit aggregation_infos(prepared_keys *pks) : pks(pks) {}
+
+    static void append_key(l_tree<std::string> &order, std::string &key) {
+        if (order.is_leaf()) {
+            key += order.value.value();
+            key += ',';
+            return;
+        }
+        key += '(';
+        for (l_tree<std::string> &child : order.children) {
+            append_key(child, key);
+        }
+        key += ')';
+    }
+
+    static std::string key(l_tree<std::string> &order) {
+        std::string key;
+        append_key(order, key);
+        return key;
+    }
+
+    bls::AggregationInfo merged_info(l_tree<std::string> &order) {
+        if (order.is_leaf()) {
+            std::string value = order.value.value();
+            if (value == "PP") {
+                return bls::AggregationInfo::FromMsgHash(pks->pk(0), pks->hash(0));
+            }
+            int i = std::stoi(value.substr(1, std::string::npos));
+            return bls::AggregationInfo::FromMsgHash(pks->pk(i), pks->hash(value.at(0) == 'P' ? 1 : 2));
+        }
+
+        std::string subtree_key = key(order);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = infos.find(subtree_key);
+            if (it != infos.end()) {
+                return it->second;
+            }
+        }
+        std::vector<bls::AggregationInfo> child_infos;
+        for (l_tree<std::string> &child : order.children) {
+            child_infos.push_back(merged_info(child));
+        }
+        bls::AggregationInfo info = bls::AggregationInfo::MergeInfos(child_infos);
+        std::lock_guard<std::mutex> guard(lock);
+        infos.emplace(subtree_key, info);
+        return info;
+    }
+
+    // (phase, aggregate of the phase's keys raised to their exponents in info) for each phase signed;
+    // false if info signs anything but the three phase messages
+    bool phase_keys(const std::string &order_key, const bls::AggregationInfo &info, std::vector<std::pair<int, bls::PublicKey>> &keys) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = phase_pks.find(order_key);
+            if (it != phase_pks.end()) {
+                keys = it->second;
+                return true;
+            }
+        }
+
+        std::vector<bls::PublicKey> info_pks = info.GetPubKeys();
+        std::vector<uint8_t *> info_hashes = info.GetMessageHashes();
+        std::vector<bls::PublicKey> exp_pks[prepared_keys::PHASES];
+        for (size_t k = 0; k < info_pks.size(); k++) {
+            int phase = 0;
+            while (phase < prepared_keys::PHASES && std::memcmp(info_hashes.at(k), pks->hash(phase), bls::BLS::MESSAGE_HASH_LEN) != 0) {
+                phase++;
+            }
+            if (phase == prepared_keys::PHASES) {
+                return false;
+            }
+
+            exponent e;
+            info.GetExponent(&e.value, info_hashes.at(k), info_pks.at(k));
+            if (bn_cmp_dig(e.value, 1) == CMP_EQ) {
+                exp_pks[phase].push_back(info_pks.at(k));
+            }
+            else {
+                exp_pks[phase].push_back(info_pks.at(k).Exp(e.value));
+            }
+        }
+
+        keys.clear();
+        for (int phase = 0; phase < prepared_keys::PHASES; phase++) {
+            if (!exp_pks[phase].empty()) {
+                keys.emplace_back(phase, bls::PublicKey::AggregateInsecure(exp_pks[phase]));
+            }
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        phase_pks.emplace(order_key, keys);
+        return true;
+    }
+};
+
+#endif
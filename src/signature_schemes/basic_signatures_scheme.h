@@ -13,14 +13,24 @@
 #include "../arguments.h"
 #include "../serialized_signatures/serialized_basic_signatures.h"
 #include "../signatures/basic_signatures.h"
+#include "prepared_keys.h"
+#include "received_signatures.h"
 #include "signature_scheme.h"
 
-class basic_signatures_scheme : public signature_scheme {
+template <int PATT, int VER>
+class basic_signatures_scheme final : public signature_scheme {
 public:
+    using signatures_type = basic_signatures<PATT>;
+    using serialized_type = serialized_basic_signatures;
+
     bls::PrivateKey sk;
-    std::vector<bls::PublicKey> pks;
+    prepared_keys *pks;
+
+    basic_signatures_scheme(bls::PrivateKey &sk, prepared_keys *pks) : sk(sk), pks(pks) {}
 
-    basic_signatures_scheme(bls::PrivateKey &sk, std::vector<bls::PublicKey> &pks) : sk(sk), pks(pks) {}
+    signatures_type * create_signatures() {
+        return new signatures_type();
+    }
 
     signature * sign_preprepare() override {
         uint8_t preprepare[1] = {0};
@@ -41,100 +51,103 @@ public:
     }
 
     bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
-        auto own_sigs = (basic_signatures *) sigs;
-        auto rcvd_ser_sigs = (serialized_basic_signatures *) ser_sigs;
+        return verify(static_cast<signatures_type *>(sigs), static_cast<serialized_type *>(ser_sigs));
+    }
+
+    bool verify(signatures_type *own_sigs, serialized_type *rcvd_ser_sigs) {
 
         std::vector<bls::Signature> batch_sigs;
-        basic_signatures new_rcvd_sigs;
+        signatures_type new_rcvd_sigs;
+
+        // select what is needed before touching any curve point
+        received_signatures rcvd_sigs;
+        int preprepare_k = -1;
+        std::vector<std::pair<int, int>> prepare_ks;
+        std::vector<std::pair<int, int>> commit_ks;
 
         if (!own_sigs->preprepare_sig.has_value() && rcvd_ser_sigs->ser_preprepare_sig.has_value()) {
-            bls::PublicKey pk = pks.at(0);
+            preprepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_preprepare_sig.value());
+        }
+        for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_prepare_sigs) {
+            if (own_sigs->prepare_sigs.size() + prepare_ks.size() >= 2*::t) { break; }
 
-            uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-            uint8_t preprepare[1] = {0};
-            bls::Util::Hash256(hash, preprepare, sizeof(preprepare));
+            if (!own_sigs->contains_prepare(pair.first)) {
+                prepare_ks.emplace_back(pair.first, rcvd_sigs.select(pair.second));
+            }
+        }
+        for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_commit_sigs) {
+            if (own_sigs->commit_sigs.size() + commit_ks.size() >= 2*::t + 1) { break; }
 
-            bls::InsecureSignature insec_sig = bls::InsecureSignature::FromBytes(rcvd_ser_sigs->ser_preprepare_sig.value());
+            if (!own_sigs->contains_commit(pair.first)) {
+                commit_ks.emplace_back(pair.first, rcvd_sigs.select(pair.second));
+            }
+        }
+
+        if (!rcvd_sigs.decompress()) {
+            return false;
+        }
 
-            if (::ver == INDIVIDUAL || ::ver == BYMSG) {
-                if (!insec_sig.Verify({hash}, {pk})) {
+        if (preprepare_k >= 0) {
+            g2_t &point = rcvd_sigs.point(preprepare_k);
+            bls::InsecureSignature insec_sig = bls::InsecureSignature::FromG2(&point);
+
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!pks->verify(0, 0, point)) {
                     return false;
                 }
             }
-            else if (::ver == BATCH) {
-                bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(pk, hash));
+            else if constexpr (VER == BATCH) {
+                bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(pks->pk(0), pks->hash(0)));
                 batch_sigs.push_back(sig);
             }
 
             new_rcvd_sigs.set_preprepare(insec_sig, rcvd_ser_sigs->ser_preprepare_sig.value());
         }
 
-        for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_prepare_sigs) {
-            if (own_sigs->prepare_sigs.size() + new_rcvd_sigs.prepare_sigs.size() >= 2*::t) { break; }
-
+        for (std::pair<int, int> pair : prepare_ks) {
             int i = pair.first;
-            uint8_t *ser_prepare_sig = pair.second;
-
-            if (!own_sigs->contains_prepare(i)) {
-                bls::PublicKey pk = pks.at(i);
+            g2_t &point = rcvd_sigs.point(pair.second);
+            bls::InsecureSignature insec_sig = bls::InsecureSignature::FromG2(&point);
 
-                uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-                uint8_t prepare[1] = {1};
-                bls::Util::Hash256(hash, prepare, sizeof(prepare));
-
-                bls::InsecureSignature insec_sig = bls::InsecureSignature::FromBytes(ser_prepare_sig);
-
-                if (::ver == INDIVIDUAL) {
-                    if (!insec_sig.Verify({hash}, {pk})) {
-                        return false;
-                    }
-                }
-                else if (::ver == BYMSG || ::ver == BATCH) {
-                    bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(pk, hash));
-                    batch_sigs.push_back(sig);
+            if constexpr (VER == INDIVIDUAL) {
+                if (!pks->verify(1, i, point)) {
+                    return false;
                 }
-
-                new_rcvd_sigs.add_prepare(i, insec_sig, ser_prepare_sig);
             }
+            else if constexpr (VER == BYMSG || VER == BATCH) {
+                bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(pks->pk(i), pks->hash(1)));
+                batch_sigs.push_back(sig);
+            }
+
+            new_rcvd_sigs.add_prepare(i, insec_sig, rcvd_sigs.selected.at(pair.second));
         }
 
-        if (::ver == BYMSG && !batch_sigs.empty()) {
+        if (VER == BYMSG && !batch_sigs.empty()) {
             if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
                 return false;
             }
             batch_sigs = {};
         }
 
-        for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_commit_sigs) {
-            if (own_sigs->commit_sigs.size() + new_rcvd_sigs.commit_sigs.size() >= 2*::t + 1) { break; }
-
+        for (std::pair<int, int> pair : commit_ks) {
             int i = pair.first;
-            uint8_t *ser_commit_sig = pair.second;
+            g2_t &point = rcvd_sigs.point(pair.second);
+            bls::InsecureSignature insec_sig = bls::InsecureSignature::FromG2(&point);
 
-            if (!own_sigs->contains_commit(i)) {
-                bls::PublicKey pk = pks.at(i);
-
-                uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-                uint8_t commit[1] = {2};
-                bls::Util::Hash256(hash, commit, sizeof(commit));
-
-                bls::InsecureSignature insec_sig = bls::InsecureSignature::FromBytes(ser_commit_sig);
-
-                if (::ver == INDIVIDUAL) {
-                    if (!insec_sig.Verify({hash}, {pk})) {
-                        return false;
-                    }
-                }
-                else if (::ver == BYMSG || ::ver == BATCH) {
-                    bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(pk, hash));
-                    batch_sigs.push_back(sig);
+            if constexpr (VER == INDIVIDUAL) {
+                if (!pks->verify(2, i, point)) {
+                    return false;
                 }
-
-                new_rcvd_sigs.add_commit(i, insec_sig, ser_commit_sig);
             }
+            else if constexpr (VER == BYMSG || VER == BATCH) {
+                bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(pks->pk(i), pks->hash(2)));
+                batch_sigs.push_back(sig);
+            }
+
+            new_rcvd_sigs.add_commit(i, insec_sig, rcvd_sigs.selected.at(pair.second));
         }
 
-        if ((::ver == BYMSG || ::ver == BATCH) && !batch_sigs.empty()) {
+        if ((VER == BYMSG || VER == BATCH) && !batch_sigs.empty()) {
             if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
                 return false;
             }
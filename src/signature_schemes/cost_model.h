@@ -0,0 +1,42 @@
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include <array>
+#include <fstream>
+#include <string>
+
+// cost in ns of the curve operations the mock scheme stands for; the defaults are rough figures for
+// relic on BLS12-381, a file of "<operation> <ns>" lines (e.g. the benchmark output) replaces them
+class cost_model {
+public:
+    enum operation { SIGN, DECOMPRESS, PAIRING, AGGREGATE, KEYAGG, SERIALIZE, OPERATIONS };
+    static constexpr std::array<const char *, OPERATIONS> NAMES = {"sign", "decompress", "pairing", "aggregate", "keyagg", "serialize"};
+
+    std::array<long, OPERATIONS> ns = {900000, 250000, 1200000, 3000, 1500, 60000};
+
+    bool load(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        std::string name;
+        long cost;
+        while (file >> name >> cost) {
+            for (int op = 0; op < OPERATIONS; op++) {
+                if (name == NAMES[op]) {
+                    ns[op] = cost;
+                }
+            }
+        }
+        return true;
+    }
+
+    // accounted to the replica instead of spent, so large configurations run in seconds
+    void charge(long &charged, operation op, long count = 1) const {
+        charged += ns[op] * count;
+    }
+};
+
+cost_model costs;
+
+#endif
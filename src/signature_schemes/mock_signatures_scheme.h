@@ -0,0 +1,99 @@
+#ifndef MOCK_SIGNATURES_SCHEME_H
+#define MOCK_SIGNATURES_SCHEME_H
+
+#include "../arguments.h"
+#include "../serialized_signatures/serialized_mock_signatures.h"
+#include "../signatures/mock_signatures.h"
+#include "cost_model.h"
+#include "signature_scheme.h"
+
+// the proof-of-possession multi-signature scheme with every curve operation replaced by its cost:
+// signatures always verify, what would have been selected, decompressed, verified and merged is charged
+template <int PATT, int VER>
+class mock_signatures_scheme final : public signature_scheme {
+public:
+    using signatures_type = mock_signatures<PATT>;
+    using serialized_type = serialized_mock_signatures;
+
+    long charged = 0; // modelled cpu, ns
+
+    signatures_type * create_signatures() {
+        return new signatures_type(&charged);
+    }
+
+    signature * sign_preprepare() override {
+        ::costs.charge(charged, cost_model::SIGN);
+        return new signature();
+    }
+
+    signature * sign_prepare() override {
+        ::costs.charge(charged, cost_model::SIGN);
+        return new signature();
+    }
+
+    signature * sign_commit() override {
+        ::costs.charge(charged, cost_model::SIGN);
+        return new signature();
+    }
+
+    // key aggregation extends the receiver's own signers when they are a subset, as the memo does
+    void charge_keys(const bitmap &signers, const bitmap &known) {
+        if (!known.empty() && signers.contains_all(known)) {
+            ::costs.charge(charged, cost_model::KEYAGG, (long) signers.minus(known).size());
+        }
+        else {
+            ::costs.charge(charged, cost_model::KEYAGG, signers.count());
+        }
+    }
+
+    bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
+        return verify(static_cast<signatures_type *>(sigs), static_cast<serialized_type *>(ser_sigs));
+    }
+
+    bool verify(signatures_type *own_sigs, serialized_type *rcvd_ser_sigs) {
+
+        signatures_type new_rcvd_sigs(&charged);
+        int selected = 0;
+        int sets = 0; // aggregated, i.e. not the pre-prepare
+
+        if (!own_sigs->preprepare && rcvd_ser_sigs->preprepare) {
+            new_rcvd_sigs.set_preprepare();
+            selected++;
+        }
+        if (rcvd_ser_sigs->prepares.has_value()
+            && !own_sigs->prepared() && own_sigs->merges_prepares(rcvd_ser_sigs->prepares.value())
+                ) {
+            charge_keys(rcvd_ser_sigs->prepares.value(), own_sigs->prepares);
+            new_rcvd_sigs.prepares = rcvd_ser_sigs->prepares.value();
+            selected++;
+            sets++;
+        }
+        if (rcvd_ser_sigs->commits.has_value()
+            && !own_sigs->committed() && own_sigs->merges_commits(rcvd_ser_sigs->commits.value())
+                ) {
+            charge_keys(rcvd_ser_sigs->commits.value(), own_sigs->commits);
+            new_rcvd_sigs.commits = rcvd_ser_sigs->commits.value();
+            selected++;
+            sets++;
+        }
+
+        if (selected > 0) {
+            ::costs.charge(charged, cost_model::DECOMPRESS, selected);
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                // e(g1, sig) against the leader's e(pk, H(m)) computed once (prepared_keys::verify), and
+                // against e(apk, H(m)) for an aggregated set
+                ::costs.charge(charged, cost_model::PAIRING, (selected - sets) + 2 * sets);
+            }
+            else if constexpr (VER == BATCH) {
+                // one pairing per message plus e(g1, aggregate)
+                ::costs.charge(charged, cost_model::AGGREGATE, selected - 1);
+                ::costs.charge(charged, cost_model::PAIRING, selected + 1);
+            }
+        }
+
+        // a set only kept as a piece is not news to pass on
+        return own_sigs->merge(new_rcvd_sigs);
+    }
+};
+
+#endif
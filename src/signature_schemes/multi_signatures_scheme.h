@@ -13,14 +13,26 @@
 #include "../l_tree.h"
 #include "../serialized_signatures/serialized_multi_signatures.h"
 #include "../signatures/multi_signatures.h"
+#include "aggregated_public_keys.h"
+#include "prepared_keys.h"
+#include "received_signatures.h"
 #include "signature_scheme.h"
 
-class multi_signatures_scheme : public signature_scheme {
+template <int PATT, int EVAL, int AGG, int VER>
+class multi_signatures_scheme final : public signature_scheme {
 public:
+    using signatures_type = multi_signatures<PATT, EVAL, AGG>;
+    using serialized_type = serialized_multi_signatures;
+
     bls::PrivateKey sk;
-    std::vector<bls::PublicKey> pks;
+    prepared_keys *pks;
+    aggregated_public_keys *agg_pks;
+
+    multi_signatures_scheme(bls::PrivateKey &sk, prepared_keys *pks, aggregated_public_keys *agg_pks) : sk(sk), pks(pks), agg_pks(agg_pks) {}
 
-    multi_signatures_scheme(bls::PrivateKey &sk, std::vector<bls::PublicKey> &pks) : sk(sk), pks(pks) {}
+    signatures_type * create_signatures() {
+        return new signatures_type(agg_pks);
+    }
 
     signature * sign_preprepare() override {
         uint8_t preprepare[1] = {0};
@@ -40,106 +52,107 @@ public:
         return new secure_signature(sig);
     }
 
-    bls::AggregationInfo merged_aggregation_info(l_tree<int> &order, uint8_t *msg, size_t len) {
+    bls::AggregationInfo merged_aggregation_info(l_tree<int> &order, int phase) {
         if (order.is_leaf()) {
             int i = order.value.value();
-            return bls::AggregationInfo::FromMsg(pks.at(i), msg, len);
+            return bls::AggregationInfo::FromMsgHash(pks->pk(i), pks->hash(phase));
         }
         else {
             std::vector<bls::AggregationInfo> infos;
-            for (l_tree<int> child : order.children) {
-                infos.push_back(merged_aggregation_info(child, msg, len));
+            for (l_tree<int> &child : order.children) {
+                infos.push_back(merged_aggregation_info(child, phase));
             }
             return bls::AggregationInfo::MergeInfos(infos);
         }
     }
 
-    bls::PublicKey aggregated_pk(l_tree<int> &order) {
-        if (order.is_leaf()) {
-            int i = order.value.value();
-            return pks.at(i);
-        }
-        else {
-            std::vector<bls::PublicKey> agg_pks;
-            for (l_tree<int> child : order.children) {
-                agg_pks.push_back(aggregated_pk(child));
-            }
-            return bls::PublicKey::Aggregate(agg_pks);
-        }
+    bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
+        return verify(static_cast<signatures_type *>(sigs), static_cast<serialized_type *>(ser_sigs));
     }
 
-    bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
-        auto own_sigs = (multi_signatures *) sigs;
-        auto rcvd_ser_sigs = (serialized_multi_signatures *) ser_sigs;
+    bool verify(signatures_type *own_sigs, serialized_type *rcvd_ser_sigs) {
 
         std::vector<bls::Signature> batch_sigs;
-        multi_signatures new_rcvd_sigs;
+        signatures_type new_rcvd_sigs(agg_pks);
 
-        if (!own_sigs->preprepare_sig.has_value()) {
-            bls::InsecureSignature sig = bls::InsecureSignature::FromBytes(rcvd_ser_sigs->ser_preprepare_sig.value());
+        // select what is needed before touching any curve point
+        received_signatures rcvd_sigs;
+        int preprepare_k = -1;
+        int prepare_k = -1;
+        int commit_k = -1;
+
+        if (!own_sigs->preprepare_sig.has_value() && rcvd_ser_sigs->ser_preprepare_sig.has_value()) {
+            preprepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_preprepare_sig.value());
+        }
+        if (rcvd_ser_sigs->ser_prepare_multisig.has_value()
+            && !own_sigs->prepared() && !own_sigs->containsall_prepares(rcvd_ser_sigs->prepares)
+                ) {
+            prepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_prepare_multisig.value());
+        }
+        if (rcvd_ser_sigs->ser_commit_multisig.has_value()
+            && !own_sigs->committed() && !own_sigs->containsall_commits(rcvd_ser_sigs->commits)
+                ) {
+            commit_k = rcvd_sigs.select(rcvd_ser_sigs->ser_commit_multisig.value());
+        }
 
-            uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-            uint8_t preprepare[1] = {0};
-            bls::Util::Hash256(hash, preprepare, sizeof(preprepare));
+        if (!rcvd_sigs.decompress()) {
+            return false;
+        }
 
-            bls::PublicKey pk = pks.at(0);
+        if (preprepare_k >= 0) {
+            g2_t &point = rcvd_sigs.point(preprepare_k);
+            bls::InsecureSignature sig = bls::InsecureSignature::FromG2(&point);
 
-            if (::ver == INDIVIDUAL || ::ver == BYMSG) {
-                if (!sig.Verify({hash}, {pk})) {
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!pks->verify(0, 0, point)) {
                     return false;
                 }
             }
-            else if (::ver == BATCH) {
-                batch_sigs.push_back(bls::Signature::FromInsecureSig(sig, bls::AggregationInfo::FromMsgHash(pk, hash)));
+            else if constexpr (VER == BATCH) {
+                batch_sigs.push_back(bls::Signature::FromInsecureSig(sig, bls::AggregationInfo::FromMsgHash(pks->pk(0), pks->hash(0))));
             }
 
             new_rcvd_sigs.set_preprepare(sig, rcvd_ser_sigs->ser_preprepare_sig.value());
         }
-        if (rcvd_ser_sigs->ser_prepare_multisig.has_value()
-            && !own_sigs->prepared() && !own_sigs->containsall_prepares(rcvd_ser_sigs->prepares)
-                ) {
-            bls::Signature multisig = bls::Signature::FromBytes(rcvd_ser_sigs->ser_prepare_multisig.value());
+        if (prepare_k >= 0) {
+            bls::Signature multisig = bls::Signature::FromInsecureSig(bls::InsecureSignature::FromG2(&rcvd_sigs.point(prepare_k)));
 
             // divide known multi-signature
-            uint8_t prepare[1] = {1};
-            if (::agg == INFOSMERGE) {
-                multisig.SetAggregationInfo(merged_aggregation_info(rcvd_ser_sigs->prepares_order.value(), prepare, sizeof(prepare)));
+            if constexpr (AGG == INFOSMERGE) {
+                multisig.SetAggregationInfo(merged_aggregation_info(rcvd_ser_sigs->prepares_order.value(), 1));
             }
-            else if (::agg == PKAGG) {
-                multisig.SetAggregationInfo(bls::AggregationInfo::FromMsg(aggregated_pk(rcvd_ser_sigs->prepares_order.value()), prepare, sizeof(prepare)));
+            else if constexpr (AGG == PKAGG) {
+                multisig.SetAggregationInfo(bls::AggregationInfo::FromMsgHash(agg_pks->aggregated_pk(rcvd_ser_sigs->prepares_order.value()), pks->hash(1)));
             }
 
-            if (::ver == INDIVIDUAL || ::ver == BYMSG) {
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
                 if (!multisig.Verify()) {
                     return false;
                 }
             }
-            else if (::ver == BATCH) {
+            else if constexpr (VER == BATCH) {
                 batch_sigs.push_back(multisig);
             }
 
             new_rcvd_sigs.set_prepares(multisig, rcvd_ser_sigs->prepares_order.value(), rcvd_ser_sigs->prepares);
         }
-        if (rcvd_ser_sigs->ser_commit_multisig.has_value()
-            && !own_sigs->committed() && !own_sigs->containsall_commits(rcvd_ser_sigs->commits)
-                ) {
-            bls::Signature multisig = bls::Signature::FromBytes(rcvd_ser_sigs->ser_commit_multisig.value());
+        if (commit_k >= 0) {
+            bls::Signature multisig = bls::Signature::FromInsecureSig(bls::InsecureSignature::FromG2(&rcvd_sigs.point(commit_k)));
 
             // divide known multi-signature
-            uint8_t commit[1] = {2};
-            if (::agg == INFOSMERGE) {
-                multisig.SetAggregationInfo(merged_aggregation_info(rcvd_ser_sigs->commits_order.value(), commit, sizeof(commit)));
+            if constexpr (AGG == INFOSMERGE) {
+                multisig.SetAggregationInfo(merged_aggregation_info(rcvd_ser_sigs->commits_order.value(), 2));
             }
-            else if (::agg == PKAGG) {
-                multisig.SetAggregationInfo(bls::AggregationInfo::FromMsg(aggregated_pk(rcvd_ser_sigs->commits_order.value()), commit, sizeof(commit)));
+            else if constexpr (AGG == PKAGG) {
+                multisig.SetAggregationInfo(bls::AggregationInfo::FromMsgHash(agg_pks->aggregated_pk(rcvd_ser_sigs->commits_order.value()), pks->hash(2)));
             }
 
-            if (::ver == INDIVIDUAL || ::ver == BYMSG) {
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
                 if (!multisig.Verify()) {
                     return false;
                 }
             }
-            else if (::ver == BATCH) {
+            else if constexpr (VER == BATCH) {
                 batch_sigs.push_back(multisig);
             }
 
@@ -147,7 +160,7 @@ public:
 
         }
 
-        if (::ver == BATCH && !batch_sigs.empty()) {
+        if (VER == BATCH && !batch_sigs.empty()) {
             if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
                 return false;
             }
@@ -0,0 +1,143 @@
+#ifndef POP_MULTI_SIGNATURES_SCHEME_H
+#define POP_MULTI_SIGNATURES_SCHEME_H
+
+#include <vector>
+
+#include <aggregationinfo.hpp>
+#include <privatekey.hpp>
+#include <publickey.hpp>
+#include <signature.hpp>
+
+#include "../arguments.h"
+#include "../serialized_signatures/serialized_pop_multi_signatures.h"
+#include "../signatures/pop_multi_signatures.h"
+#include "aggregated_public_keys.h"
+#include "prepared_keys.h"
+#include "received_signatures.h"
+#include "signature_scheme.h"
+
+template <int PATT, int EVAL, int VER>
+class pop_multi_signatures_scheme final : public signature_scheme {
+public:
+    using signatures_type = pop_multi_signatures<PATT, EVAL>;
+    using serialized_type = serialized_pop_multi_signatures;
+
+    bls::PrivateKey sk;
+    prepared_keys *pks; // proofs of possession checked at registration
+    pop_aggregated_public_keys *agg_pks;
+
+    pop_multi_signatures_scheme(bls::PrivateKey &sk, prepared_keys *pks, pop_aggregated_public_keys *agg_pks) : sk(sk), pks(pks), agg_pks(agg_pks) {}
+
+    signatures_type * create_signatures() {
+        return new signatures_type();
+    }
+
+    signature * sign_preprepare() override {
+        uint8_t preprepare[1] = {0};
+        bls::InsecureSignature sig = sk.SignInsecure(preprepare, sizeof(preprepare));
+        return new insecure_signature(sig);
+    }
+
+    signature * sign_prepare() override {
+        uint8_t prepare[1] = {1};
+        bls::InsecureSignature sig = sk.SignInsecure(prepare, sizeof(prepare));
+        return new insecure_signature(sig);
+    }
+
+    signature * sign_commit() override {
+        uint8_t commit[1] = {2};
+        bls::InsecureSignature sig = sk.SignInsecure(commit, sizeof(commit));
+        return new insecure_signature(sig);
+    }
+
+    bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
+        return verify(static_cast<signatures_type *>(sigs), static_cast<serialized_type *>(ser_sigs));
+    }
+
+    bool verify(signatures_type *own_sigs, serialized_type *rcvd_ser_sigs) {
+
+        std::vector<bls::Signature> batch_sigs;
+        signatures_type new_rcvd_sigs;
+
+        // select what is needed before touching any curve point: sets without a signer not seen yet are not verified
+        received_signatures rcvd_sigs;
+        int preprepare_k = -1;
+        int prepare_k = -1;
+        int commit_k = -1;
+
+        if (!own_sigs->preprepare_sig.has_value() && rcvd_ser_sigs->ser_preprepare_sig.has_value()) {
+            preprepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_preprepare_sig.value());
+        }
+        if (rcvd_ser_sigs->ser_prepare_multisig.has_value()
+            && !own_sigs->prepared() && own_sigs->merges_prepares(rcvd_ser_sigs->prepares)
+                ) {
+            prepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_prepare_multisig.value());
+        }
+        if (rcvd_ser_sigs->ser_commit_multisig.has_value()
+            && !own_sigs->committed() && own_sigs->merges_commits(rcvd_ser_sigs->commits)
+                ) {
+            commit_k = rcvd_sigs.select(rcvd_ser_sigs->ser_commit_multisig.value());
+        }
+
+        if (!rcvd_sigs.decompress()) {
+            return false;
+        }
+
+        if (preprepare_k >= 0) {
+            g2_t &point = rcvd_sigs.point(preprepare_k);
+            bls::InsecureSignature sig = bls::InsecureSignature::FromG2(&point);
+
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!pks->verify(0, 0, point)) {
+                    return false;
+                }
+            }
+            else if constexpr (VER == BATCH) {
+                batch_sigs.push_back(bls::Signature::FromInsecureSig(sig, bls::AggregationInfo::FromMsgHash(pks->pk(0), pks->hash(0))));
+            }
+
+            new_rcvd_sigs.set_preprepare(sig, rcvd_ser_sigs->ser_preprepare_sig.value());
+        }
+        if (prepare_k >= 0) {
+            bls::InsecureSignature multisig = bls::InsecureSignature::FromG2(&rcvd_sigs.point(prepare_k));
+            bls::PublicKey agg_pk = agg_pks->aggregated_pk(rcvd_ser_sigs->prepares, own_sigs->prepares);
+
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!multisig.Verify({pks->hash(1)}, {agg_pk})) {
+                    return false;
+                }
+            }
+            else if constexpr (VER == BATCH) {
+                batch_sigs.push_back(bls::Signature::FromInsecureSig(multisig, bls::AggregationInfo::FromMsgHash(agg_pk, pks->hash(1))));
+            }
+
+            new_rcvd_sigs.set_prepares(multisig, rcvd_ser_sigs->prepares);
+        }
+        if (commit_k >= 0) {
+            bls::InsecureSignature multisig = bls::InsecureSignature::FromG2(&rcvd_sigs.point(commit_k));
+            bls::PublicKey agg_pk = agg_pks->aggregated_pk(rcvd_ser_sigs->commits, own_sigs->commits);
+
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!multisig.Verify({pks->hash(2)}, {agg_pk})) {
+                    return false;
+                }
+            }
+            else if constexpr (VER == BATCH) {
+                batch_sigs.push_back(bls::Signature::FromInsecureSig(multisig, bls::AggregationInfo::FromMsgHash(agg_pk, pks->hash(2))));
+            }
+
+            new_rcvd_sigs.set_commits(multisig, rcvd_ser_sigs->commits);
+        }
+
+        if (VER == BATCH && !batch_sigs.empty()) {
+            if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
+                return false;
+            }
+        }
+
+        // a set only kept as a piece is not news to pass on
+        return own_sigs->merge(new_rcvd_sigs);
+    }
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef PREPARED_KEYS_H
+#define PREPARED_KEYS_H
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <publickey.hpp>
+#include <signature.hpp>
+#include <util.hpp>
+
+class prepared_pairing {
+public:
+    gt_t e;
+};
+
+// phase messages are fixed ({0} pre-prepare, {1} prepare, {2} commit), so e(pk, H(m)) is fixed
+// for every key: verifying a signature on m is then a single pairing e(g1, sig) against the table,
+// each entry computed once on first use (most keys never sign a pre-prepare)
+class prepared_keys {
+public:
+    static const int PHASES = 3;
+
+    std::vector<bls::PublicKey> pks;
+
+    uint8_t hashes[PHASES][bls::BLS::MESSAGE_HASH_LEN];
+    g2_t mapped_hashes[PHASES];
+    g1_t generator;
+
+    std::vector<prepared_pairing> pairings[PHASES];
+    std::unique_ptr<std::once_flag[]> prepared[PHASES]; // replicas may share the table across threads
+
+    explicit prepared_keys(std::vector<bls::PublicKey> pks) : pks(std::move(pks)) {
+        g1_get_gen(generator);
+        for (int phase = 0; phase < PHASES; phase++) {
+            uint8_t msg[1] = {(uint8_t) phase};
+            bls::Util::Hash256(hashes[phase], msg, sizeof(msg));
+            g2_map(mapped_hashes[phase], hashes[phase], bls::BLS::MESSAGE_HASH_LEN, 0);
+
+            pairings[phase].resize(this->pks.size());
+            prepared[phase] = std::make_unique<std::once_flag[]>(this->pks.size());
+        }
+    }
+
+    const uint8_t * hash(int phase) {
+        return hashes[phase];
+    }
+
+    bls::PublicKey & pk(int i) {
+        return pks.at(i);
+    }
+
+    prepared_pairing & pairing(int phase, int i) {
+        prepared_pairing &entry = pairings[phase].at(i);
+        std::call_once(prepared[phase][i], [this, phase, i, &entry]() {
+            g1_t q;
+            read_g1(q, pks.at(i));
+            pc_map(entry.e, q, mapped_hashes[phase]);
+        });
+        return entry;
+    }
+
+    bool verify(int phase, int i, g2_t sig) {
+        gt_t e;
+        pc_map(e, generator, sig);
+        return gt_cmp(e, pairing(phase, i).e) == CMP_EQ;
+    }
+
+    // bls (v0.1) keeps the points of its keys and signatures private, so they are read back with relic from
+    // the library's serialization: a compressed point whose top bit carries the sign of y, where relic expects
+    // a 0x02/0x03 prefix byte instead
+    static void uncompress(uint8_t *prefixed, const uint8_t *serialized, size_t size) {
+        std::memcpy(prefixed + 1, serialized, size);
+        prefixed[0] = (serialized[0] & 0x80) ? 0x03 : 0x02;
+        prefixed[1] &= 0x7f;
+    }
+
+    static void read_g1(g1_t point, const bls::PublicKey &pk) {
+        uint8_t ser_pk[bls::PublicKey::PUBLIC_KEY_SIZE];
+        pk.Serialize(ser_pk);
+        uint8_t prefixed[bls::PublicKey::PUBLIC_KEY_SIZE + 1];
+        uncompress(prefixed, ser_pk, sizeof(ser_pk));
+        g1_read_bin(point, prefixed, sizeof(prefixed));
+    }
+
+    static void read_g2(g2_t point, const uint8_t *ser_sig) {
+        uint8_t prefixed[bls::InsecureSignature::SIGNATURE_SIZE + 1];
+        uncompress(prefixed, ser_sig, bls::InsecureSignature::SIGNATURE_SIZE);
+        g2_read_bin(point, prefixed, sizeof(prefixed));
+    }
+};
+
+#endif
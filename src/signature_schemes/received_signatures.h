@@ -0,0 +1,50 @@
+#ifndef RECEIVED_SIGNATURES_H
+#define RECEIVED_SIGNATURES_H
+
+#include <algorithm>
+#include <vector>
+
+#include <bls.hpp>
+
+#include "../async/worker.h"
+#include "prepared_keys.h"
+
+class prepared_point {
+public:
+    g2_t p;
+};
+
+// received signatures stay raw bytes until selected for a quorum; the selection is then decompressed
+// and subgroup-checked in one batch, split over the helper pool (::workers threads)
+class received_signatures {
+public:
+    std::vector<uint8_t *> selected;
+    std::vector<prepared_point> points;
+
+    int select(uint8_t *ser_sig) {
+        selected.push_back(ser_sig);
+        return (int) selected.size() - 1;
+    }
+
+    bool decompress() {
+        points.resize(selected.size());
+        std::vector<char> valid(selected.size(), 0);
+
+        auto decompress_range = [this, &valid](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                prepared_keys::read_g2(points[k].p, selected[k]);
+                valid[k] = g2_is_valid(points[k].p);
+            }
+        };
+
+        helper_pool().parallel_for(selected.size(), decompress_range);
+
+        return std::find(valid.begin(), valid.end(), 0) == valid.end();
+    }
+
+    g2_t & point(int k) {
+        return points.at(k).p;
+    }
+};
+
+#endif
@@ -11,32 +11,39 @@
 #include <util.hpp>
 
 #include "../arguments.h"
+#include "prepared_keys.h"
+#include "received_signatures.h"
 #include "signature_scheme.h"
 #include "../serialized_signatures/serialized_threshold_signatures.h"
 #include "../signatures/threshold_signatures.h"
 
-class threshold_signatures_scheme : public signature_scheme {
+template <int PATT, int VER>
+class threshold_signatures_scheme final : public signature_scheme {
 public:
-    std::optional<bls::PrivateKey> preprepare_sk; // only coord has one
-    bls::PublicKey preprepare_pk;
+    using signatures_type = threshold_signatures<PATT>;
+    using serialized_type = serialized_threshold_signatures;
 
+    std::optional<bls::PrivateKey> preprepare_sk; // only coord has one
     std::optional<bls::PrivateKey> prepare_secret_share; // coord doesn't have one
-    std::vector<bls::PublicKey> prepare_pks;
-    bls::PublicKey prepare_master_pk;
-
     bls::PrivateKey commit_secret_share;
-    std::vector<bls::PublicKey> commit_pks;
-    bls::PublicKey commit_master_pk;
 
-    threshold_signatures_scheme(bls::PrivateKey &preprepare_sk, bls::PublicKey &preprepare_pk, std::vector<bls::PublicKey> &prepare_pks, bls::PublicKey &prepare_master_pk,
-            bls::PrivateKey &commit_secret_share, std::vector<bls::PublicKey> &commit_pks, bls::PublicKey &commit_master_pk) :
-            preprepare_sk(preprepare_sk), preprepare_pk(preprepare_pk), prepare_pks(prepare_pks), prepare_master_pk(prepare_master_pk),
-            commit_secret_share(commit_secret_share), commit_pks(commit_pks), commit_master_pk(commit_master_pk) {}
+    prepared_keys *master_pks; // preprepare_pk, prepare_master_pk, commit_master_pk (indexed by phase)
+    prepared_keys *prepare_pks;
+    prepared_keys *commit_pks;
+
+    threshold_signatures_scheme(bls::PrivateKey &preprepare_sk, bls::PrivateKey &commit_secret_share, prepared_keys *master_pks,
+            prepared_keys *prepare_pks, prepared_keys *commit_pks) :
+            preprepare_sk(preprepare_sk), commit_secret_share(commit_secret_share), master_pks(master_pks),
+            prepare_pks(prepare_pks), commit_pks(commit_pks) {}
+
+    threshold_signatures_scheme(prepared_keys *master_pks, bls::PrivateKey &prepare_secret_share, bls::PrivateKey &commit_secret_share,
+            prepared_keys *prepare_pks, prepared_keys *commit_pks) :
+            prepare_secret_share(prepare_secret_share), commit_secret_share(commit_secret_share), master_pks(master_pks),
+            prepare_pks(prepare_pks), commit_pks(commit_pks) {}
 
-    threshold_signatures_scheme(bls::PublicKey &preprepare_pk, bls::PrivateKey &prepare_secret_share, std::vector<bls::PublicKey> &prepare_pks,
-            bls::PublicKey &prepare_master_pk, bls::PrivateKey &commit_secret_share, std::vector<bls::PublicKey> &commit_pks, bls::PublicKey &commit_master_pk) :
-            preprepare_pk(preprepare_pk), prepare_secret_share(prepare_secret_share), prepare_pks(prepare_pks), prepare_master_pk(prepare_master_pk),
-            commit_secret_share(commit_secret_share), commit_pks(commit_pks), commit_master_pk(commit_master_pk) {}
+    signatures_type * create_signatures() {
+        return new signatures_type();
+    }
 
     signature * sign_preprepare() override {
         uint8_t preprepare[1] = {0};
@@ -57,145 +64,156 @@ public:
     }
 
     bool verify(signatures *sigs, serialized_signatures *ser_sigs) override {
-        auto own_sigs = (threshold_signatures *) sigs;
-        auto rcvd_ser_sigs = (serialized_threshold_signatures *) ser_sigs;
+        return verify(static_cast<signatures_type *>(sigs), static_cast<serialized_type *>(ser_sigs));
+    }
+
+    bool verify(signatures_type *own_sigs, serialized_type *rcvd_ser_sigs) {
 
         std::vector<bls::Signature> batch_sigs;
-        threshold_signatures new_rcvd_sigs;
+        signatures_type new_rcvd_sigs;
+
+        // select what is needed before touching any curve point
+        received_signatures rcvd_sigs;
+        int preprepare_k = -1;
+        int prepare_k = -1;
+        int commit_k = -1;
+        std::vector<std::pair<int, int>> prepare_share_ks;
+        std::vector<std::pair<int, int>> commit_share_ks;
+
+        if (!own_sigs->preprepare_sig.has_value() && rcvd_ser_sigs->ser_preprepare_sig.has_value()) {
+            preprepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_preprepare_sig.value());
+        }
+        if (!own_sigs->prepare_sig.has_value()) {
+            if (rcvd_ser_sigs->ser_prepare_sig.has_value()) {
+                prepare_k = rcvd_sigs.select(rcvd_ser_sigs->ser_prepare_sig.value());
+            }
+            else {
+                for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_prepare_shares) {
+                    if (own_sigs->prepare_shares.size() + prepare_share_ks.size() >= 2*::t) { break; }
+
+                    if (!own_sigs->contains_prepare(pair.first)) {
+                        prepare_share_ks.emplace_back(pair.first, rcvd_sigs.select(pair.second));
+                    }
+                }
+            }
+        }
+        if (!own_sigs->commit_sig.has_value()) {
+            if (rcvd_ser_sigs->ser_commit_sig.has_value()) {
+                commit_k = rcvd_sigs.select(rcvd_ser_sigs->ser_commit_sig.value());
+            }
+            else {
+                for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_commit_shares) {
+                    if (own_sigs->commit_shares.size() + commit_share_ks.size() >= 2*::t + 1) { break; }
 
-        if (!own_sigs->preprepare_sig.has_value()) {
-            bls::InsecureSignature insec_sig = bls::InsecureSignature::FromBytes(rcvd_ser_sigs->ser_preprepare_sig.value());
+                    if (!own_sigs->contains_commit(pair.first)) {
+                        commit_share_ks.emplace_back(pair.first, rcvd_sigs.select(pair.second));
+                    }
+                }
+            }
+        }
 
-            uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-            uint8_t preprepare[1] = {0};
-            bls::Util::Hash256(hash, preprepare, sizeof(preprepare));
+        if (!rcvd_sigs.decompress()) {
+            return false;
+        }
 
-            if (::ver == INDIVIDUAL || ::ver == BYMSG) {
-                if (!insec_sig.Verify({hash}, {preprepare_pk})) {
+        if (preprepare_k >= 0) {
+            g2_t &point = rcvd_sigs.point(preprepare_k);
+            bls::InsecureSignature insec_sig = bls::InsecureSignature::FromG2(&point);
+
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!master_pks->verify(0, 0, point)) {
                     return false;
                 }
             }
-            else if (::ver == BATCH) {
-                bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(preprepare_pk, hash));
+            else if constexpr (VER == BATCH) {
+                bls::Signature sig = bls::Signature::FromInsecureSig(insec_sig, bls::AggregationInfo::FromMsgHash(master_pks->pk(0), master_pks->hash(0)));
                 batch_sigs.push_back(sig);
             }
             new_rcvd_sigs.set_preprepare(insec_sig, rcvd_ser_sigs->ser_preprepare_sig.value());
         }
 
-        if (!own_sigs->prepare_sig.has_value()) {
-            if (rcvd_ser_sigs->ser_prepare_sig.has_value()) {
-                bls::InsecureSignature prepare_sig = bls::InsecureSignature::FromBytes(rcvd_ser_sigs->ser_prepare_sig.value());
+        if (prepare_k >= 0) {
+            g2_t &point = rcvd_sigs.point(prepare_k);
+            bls::InsecureSignature prepare_sig = bls::InsecureSignature::FromG2(&point);
 
-                uint8_t hash[32];
-                uint8_t prepare[1] = {1};
-                bls::Util::Hash256(hash, prepare, sizeof(prepare));
-
-                if (::ver == INDIVIDUAL || ::ver == BYMSG) {
-                    if (!prepare_sig.Verify({hash}, {prepare_master_pk})) {
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!master_pks->verify(1, 1, point)) {
+                    return false;
+                }
+            }
+            else if constexpr (VER == BATCH) {
+                bls::Signature sig = bls::Signature::FromInsecureSig(prepare_sig, bls::AggregationInfo::FromMsgHash(master_pks->pk(1), master_pks->hash(1)));
+                batch_sigs.push_back(sig);
+            }
+            new_rcvd_sigs.set_prepare(prepare_sig, rcvd_ser_sigs->ser_prepare_sig.value());
+        }
+        else if (!prepare_share_ks.empty()) {
+            for (std::pair<int, int> pair : prepare_share_ks) {
+                int i = pair.first;
+                g2_t &point = rcvd_sigs.point(pair.second);
+                bls::InsecureSignature share = bls::InsecureSignature::FromG2(&point);
+
+                if constexpr (VER == INDIVIDUAL) {
+                    if (!prepare_pks->verify(1, i-1, point)) {
                         return false;
                     }
                 }
-                else if (::ver == BATCH) {
-                    bls::Signature sig = bls::Signature::FromInsecureSig(prepare_sig, bls::AggregationInfo::FromMsgHash(prepare_master_pk, hash));
+                else if constexpr (VER == BYMSG || VER == BATCH) {
+                    bls::Signature sig = bls::Signature::FromInsecureSig(share, bls::AggregationInfo::FromMsgHash(prepare_pks->pk(i-1), prepare_pks->hash(1)));
                     batch_sigs.push_back(sig);
                 }
-                new_rcvd_sigs.set_prepare(prepare_sig, rcvd_ser_sigs->ser_prepare_sig.value());
-            }
-            else {
-                for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_prepare_shares) {
-                    if (own_sigs->prepare_shares.size() + new_rcvd_sigs.prepare_shares.size() >= 2*::t) { break; }
-
-                    int i = pair.first;
-                    uint8_t *ser_prepare_share = pair.second;
 
-                    if (!own_sigs->contains_prepare(i)) {
-                        bls::InsecureSignature share = bls::InsecureSignature::FromBytes(ser_prepare_share);
-
-                        uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-                        uint8_t prepare[1] = {1};
-                        bls::Util::Hash256(hash, prepare, sizeof(prepare));
-
-                        bls::PublicKey pk = prepare_pks.at(i-1);
-
-                        if (::ver == INDIVIDUAL) {
-                            if (!share.Verify({hash}, {pk})) {
-                                return false;
-                            }
-                        }
-                        else if (::ver == BYMSG || ::ver == BATCH) {
-                            bls::Signature sig = bls::Signature::FromInsecureSig(share, bls::AggregationInfo::FromMsgHash(pk, hash));
-                            batch_sigs.push_back(sig);
-                        }
-
-                        new_rcvd_sigs.add_prepare(i, share, ser_prepare_share);
-                    }
-                }
-                if (::ver == BYMSG && !batch_sigs.empty()) {
-                    if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
-                        return false;
-                    }
-                    batch_sigs = {};
+                new_rcvd_sigs.add_prepare(i, share, rcvd_sigs.selected.at(pair.second));
+            }
+            if (VER == BYMSG && !batch_sigs.empty()) {
+                if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
+                    return false;
                 }
+                batch_sigs = {};
             }
         }
 
-        if (!own_sigs->commit_sig.has_value()) {
-            if (rcvd_ser_sigs->ser_commit_sig.has_value()) {
-                bls::InsecureSignature commit_sig = bls::InsecureSignature::FromBytes(rcvd_ser_sigs->ser_commit_sig.value());
+        if (commit_k >= 0) {
+            g2_t &point = rcvd_sigs.point(commit_k);
+            bls::InsecureSignature commit_sig = bls::InsecureSignature::FromG2(&point);
 
-                uint8_t hash[32];
-                uint8_t commit[1] = {2};
-                bls::Util::Hash256(hash, commit, sizeof(commit));
-
-                if (::ver == INDIVIDUAL || ::ver == BYMSG) {
-                    if (!commit_sig.Verify({hash}, {commit_master_pk})) {
+            if constexpr (VER == INDIVIDUAL || VER == BYMSG) {
+                if (!master_pks->verify(2, 2, point)) {
+                    return false;
+                }
+            }
+            else if constexpr (VER == BATCH) {
+                bls::Signature sig = bls::Signature::FromInsecureSig(commit_sig, bls::AggregationInfo::FromMsgHash(master_pks->pk(2), master_pks->hash(2)));
+                batch_sigs.push_back(sig);
+            }
+            new_rcvd_sigs.set_commit(commit_sig, rcvd_ser_sigs->ser_commit_sig.value());
+        }
+        else if (!commit_share_ks.empty()) {
+            for (std::pair<int, int> pair : commit_share_ks) {
+                int i = pair.first;
+                g2_t &point = rcvd_sigs.point(pair.second);
+                bls::InsecureSignature share = bls::InsecureSignature::FromG2(&point);
+
+                if constexpr (VER == INDIVIDUAL) {
+                    if (!commit_pks->verify(2, i, point)) {
                         return false;
                     }
                 }
-                else if (::ver == BATCH) {
-                    bls::Signature sig = bls::Signature::FromInsecureSig(commit_sig, bls::AggregationInfo::FromMsgHash(commit_master_pk, hash));
+                else if constexpr (VER == BYMSG || VER == BATCH) {
+                    bls::Signature sig = bls::Signature::FromInsecureSig(share, bls::AggregationInfo::FromMsgHash(commit_pks->pk(i), commit_pks->hash(2)));
                     batch_sigs.push_back(sig);
                 }
-                new_rcvd_sigs.set_commit(commit_sig, rcvd_ser_sigs->ser_commit_sig.value());
-            }
-            else {
-                for (std::pair<int, uint8_t *> pair : rcvd_ser_sigs->ser_commit_shares) {
-                    if (own_sigs->commit_shares.size() + new_rcvd_sigs.commit_shares.size() >= 2*::t + 1) { break; }
-
-                    int i = pair.first;
-                    uint8_t *ser_commit_share = pair.second;
-
-                    if (!own_sigs->contains_commit(i)) {
-                        bls::InsecureSignature share = bls::InsecureSignature::FromBytes(ser_commit_share);
 
-                        uint8_t hash[bls::BLS::MESSAGE_HASH_LEN];
-                        uint8_t commit[1] = {2};
-                        bls::Util::Hash256(hash, commit, sizeof(commit));
-
-                        bls::PublicKey pk = commit_pks.at(i);
-
-                        if (::ver == INDIVIDUAL) {
-                            if (!share.Verify({hash}, {pk})) {
-                                return false;
-                            }
-                        }
-                        else if (::ver == BYMSG || ::ver == BATCH) {
-                            bls::Signature sig = bls::Signature::FromInsecureSig(share, bls::AggregationInfo::FromMsgHash(pk, hash));
-                            batch_sigs.push_back(sig);
-                        }
-
-                        new_rcvd_sigs.add_commit(i, share, ser_commit_share);
-                    }
-                }
-                if (::ver == BYMSG && !batch_sigs.empty()) {
-                    if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
-                        return false;
-                    }
+                new_rcvd_sigs.add_commit(i, share, rcvd_sigs.selected.at(pair.second));
+            }
+            if (VER == BYMSG && !batch_sigs.empty()) {
+                if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
+                    return false;
                 }
             }
         }
 
-        if (::ver == BATCH && !batch_sigs.empty()) {
+        if (VER == BATCH && !batch_sigs.empty()) {
             if (!bls::Signature::Aggregate(batch_sigs).Verify()) {
                 return false;
             }
@@ -0,0 +1,49 @@
+#ifndef ADAPTIVE_EVALUATION_H
+#define ADAPTIVE_EVALUATION_H
+
+#include <chrono>
+#include <cstddef>
+
+// ADAPTIVE evaluation of one phase: moving averages of the gap between arrivals and of the cost of
+// aggregating one signature; a signature is aggregated on arrival (EAGER) when the next one is not
+// expected before that cost is paid, and left for serialize() (LAZY) when arrivals come in bursts
+class adaptive_evaluation {
+public:
+    static constexpr double WEIGHT = 0.25;
+
+    std::chrono::steady_clock::time_point last_arrival;
+    bool arrived = false;
+
+    double gap = -1; // ns, unknown until the second arrival
+    double cost = -1; // ns per aggregated signature, unknown until the first aggregation
+
+    static double average(double current, double sample) {
+        return current < 0 ? sample : WEIGHT * sample + (1 - WEIGHT) * current;
+    }
+
+    // records an arrival, true if it should be aggregated right away
+    bool arrival() {
+        auto now = std::chrono::steady_clock::now();
+        if (arrived) {
+            gap = average(gap, std::chrono::duration<double, std::nano>(now - last_arrival).count());
+        }
+        last_arrival = now;
+        arrived = true;
+
+        if (gap < 0) {
+            return false;
+        }
+        // aggregate eagerly until the cost is known
+        return cost < 0 || gap > cost;
+    }
+
+    // an aggregation of count signatures that began at started
+    void measured(size_t count, std::chrono::steady_clock::time_point started) {
+        if (count > 0) {
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+            cost = average(cost, elapsed / count);
+        }
+    }
+};
+
+#endif
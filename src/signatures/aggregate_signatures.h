@@ -1,6 +1,7 @@
 #ifndef AGGREGATE_SIGNATURES_H
 #define AGGREGATE_SIGNATURES_H
 
+#include <chrono>
 #include <optional>
 #include <string>
 #include <unordered_set>
@@ -11,49 +12,78 @@
 #include "../arguments.h"
 #include "../l_tree.h"
 #include "../serialized_signatures/serialized_aggregate_signatures.h"
+#include "adaptive_evaluation.h"
+#include "background_fold.h"
 #include "signatures.h"
 
-class aggregate_signatures : public signatures {
+template <int EVAL>
+class aggregate_signatures final : public signatures {
 public:
     aggregate_signatures() : signatures(new serialized_aggregate_signatures()) {}
 
+    serialized_aggregate_signatures * serialized() {
+        return static_cast<serialized_aggregate_signatures *>(ser_sigs);
+    }
+
     std::optional<bls::Signature> agg_sig;
     std::vector<bls::Signature> pending_sigs;
 
     std::optional<l_tree<std::string>> agg_order;
     std::vector<l_tree<std::string>> pending_orders;
+    background_fold<std::string> fold;
+    adaptive_evaluation eval;
 
     std::unordered_set<int> prepares;
     std::unordered_set<int> commits;
 
     void add_sig(bls::Signature &sig, const l_tree<std::string>& order) {
-        if (::eval == EAGER) {
-            if (!agg_sig.has_value()) {
-                agg_sig = bls::Signature(sig);
-                agg_order = l_tree<std::string>(order);
+        if constexpr (EVAL == EAGER) {
+            aggregate_sig(sig, order);
+        }
+        else if constexpr (EVAL == ADAPTIVE) {
+            if (eval.arrival()) {
+                aggregate_sig(sig, order);
             }
             else {
-                agg_sig = bls::Signature(bls::Signature::Aggregate({agg_sig.value(), sig}));
-                agg_order = l_tree<std::string>((std::vector<l_tree<std::string>>) {agg_order.value(), order});
+                pending_sigs.push_back(bls::Signature(sig));
+                pending_orders.push_back(order);
             }
         }
-        else if (::eval == LAZY) {
+        else if constexpr (EVAL == LAZY || EVAL == BACKGROUND) {
             pending_sigs.push_back(bls::Signature(sig));
             pending_orders.push_back(order);
+            if constexpr (EVAL == BACKGROUND) {
+                fold.add(pending_sigs, pending_orders, [](bls::Signature &, l_tree<std::string> &) {});
+            }
+        }
+    }
+
+    void aggregate_sig(bls::Signature &sig, const l_tree<std::string>& order) {
+        if (!agg_sig.has_value()) {
+            agg_sig = bls::Signature(sig);
+            agg_order = l_tree<std::string>(order);
+        }
+        else {
+            auto started = std::chrono::steady_clock::now();
+            agg_sig = bls::Signature(bls::Signature::Aggregate({agg_sig.value(), sig}));
+            agg_order = l_tree<std::string>((std::vector<l_tree<std::string>>) {agg_order.value(), order});
+            if constexpr (EVAL == ADAPTIVE) {
+                eval.measured(1, started);
+            }
         }
     }
 
     void add_preprepare(signature *sec_sig) override {
-        add_sig(((secure_signature *) sec_sig)->sig, l_tree<std::string>("PP"));
+        add_sig(static_cast<secure_signature *>(sec_sig)->sig, l_tree<std::string>("PP"));
     }
 
     void add_prepare(int i, signature *sec_sig) override {
-        add_sig(((secure_signature *) sec_sig)->sig, l_tree<std::string>("P" + std::to_string(i)));
+        add_sig(static_cast<secure_signature *>(sec_sig)->sig, l_tree<std::string>("P" + std::to_string(i)));
         prepares.insert(i);
     }
 
     void add_commit(int i, signature *sec_sig) override {
-        add_sig(((secure_signature *) sec_sig)->sig, l_tree<std::string>("C" + std::to_string(i)));
+        add_sig(static_cast<secure_signature *>(sec_sig)->sig, l_tree<std::string>("C" + std::to_string(i)));
         commits.insert(i);
     }
 
@@ -117,7 +147,26 @@ public:
     }
 
     serialized_signatures * serialize() override {
-        if (::eval == LAZY) {
+        if constexpr (EVAL == BACKGROUND) {
+            fold.finish(pending_sigs, pending_orders);
+        }
+        if constexpr (EVAL == ADAPTIVE) {
+            // whatever was aggregated on arrival is folded with the deferred ones, if any
+            if (!pending_sigs.empty()) {
+                auto started = std::chrono::steady_clock::now();
+                size_t count = pending_sigs.size();
+                if (agg_sig.has_value()) {
+                    pending_sigs.push_back(agg_sig.value());
+                    pending_orders.push_back(agg_order.value());
+                }
+                agg_sig = bls::Signature(bls::Signature::Aggregate(pending_sigs));
+                agg_order = l_tree<std::string>(pending_orders);
+                pending_sigs.clear();
+                pending_orders.clear();
+                eval.measured(count, started);
+            }
+        }
+        else if constexpr (EVAL == LAZY || EVAL == BACKGROUND) {
             if (agg_sig.has_value()) {
                 pending_sigs.push_back(agg_sig.value());
             }
@@ -130,15 +179,15 @@ public:
             agg_order = l_tree<std::string>(pending_orders);
             pending_orders.clear();
         }
-        uint8_t *ser_sig = new uint8_t[bls::Signature::SIGNATURE_SIZE];
+        uint8_t *ser_sig = buffer(bls::Signature::SIGNATURE_SIZE);
         agg_sig.value().Serialize(ser_sig);
-        ((serialized_aggregate_signatures *) ser_sigs)->update(ser_sig, agg_order.value(), prepares, commits);
+        serialized()->update(ser_sig, agg_order.value(), prepares, commits);
 
-        return new serialized_aggregate_signatures(*((serialized_aggregate_signatures *) ser_sigs));
+        return new serialized_aggregate_signatures(*serialized());
     }
 
     bool empty() {
-        return !agg_sig.has_value() && pending_sigs.empty();
+        return !agg_sig.has_value() && pending_sigs.empty() && !fold.running.has_value();
     }
 };
 
@@ -0,0 +1,62 @@
+#ifndef BACKGROUND_FOLD_H
+#define BACKGROUND_FOLD_H
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <signature.hpp>
+
+#include "../async/worker.h"
+#include "../l_tree.h"
+
+// BACKGROUND evaluation of one phase: pending signatures are aggregated on the aggregation worker while
+// the replica keeps receiving; a finished fold goes back to the pending list as a single signature
+// with its order subtree, so serialize() is left with a couple of signatures instead of all of them
+template <class T>
+class background_fold {
+public:
+    using result = std::pair<bls::Signature, l_tree<T>>;
+
+    std::optional<std::shared_future<result>> running;
+
+    // after each new pending signature; finish(sig, order) completes the folded signature on the worker
+    // (e.g. collapses its aggregation info under PKAGG)
+    template <class FINISH>
+    void add(std::vector<bls::Signature> &pending_sigs, std::vector<l_tree<T>> &pending_orders, FINISH finish) {
+        collect(pending_sigs, pending_orders, false);
+        if (!running.has_value() && pending_sigs.size() >= 2) {
+            auto fold = std::make_shared<std::promise<result>>();
+            running = fold->get_future().share();
+
+            std::vector<bls::Signature> sigs;
+            std::vector<l_tree<T>> orders;
+            sigs.swap(pending_sigs);
+            orders.swap(pending_orders);
+            aggregation_worker().post([fold, finish, sigs = std::move(sigs), orders = std::move(orders)]() {
+                result folded(bls::Signature::Aggregate(sigs), l_tree<T>(orders));
+                finish(folded.first, folded.second);
+                fold->set_value(folded);
+            });
+        }
+    }
+
+    // before serializing: the running fold is waited for, since the result must cover every signer
+    void finish(std::vector<bls::Signature> &pending_sigs, std::vector<l_tree<T>> &pending_orders) {
+        collect(pending_sigs, pending_orders, true);
+    }
+
+    void collect(std::vector<bls::Signature> &pending_sigs, std::vector<l_tree<T>> &pending_orders, bool wait) {
+        if (running.has_value() && (wait || running->wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+            const result &folded = running->get();
+            pending_sigs.push_back(folded.first);
+            pending_orders.push_back(folded.second);
+            running.reset();
+        }
+    }
+};
+
+#endif
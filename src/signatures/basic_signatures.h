@@ -10,7 +10,8 @@
 #include "signatures.h"
 #include "../serialized_signatures/serialized_basic_signatures.h"
 
-class basic_signatures : public signatures {
+template <int PATT>
+class basic_signatures final : public signatures {
 public:
     std::optional<bls::InsecureSignature> preprepare_sig;
     std::map<int, bls::InsecureSignature> prepare_sigs;
@@ -18,8 +19,12 @@ public:
 
     basic_signatures() : signatures(new serialized_basic_signatures()) {}
 
+    serialized_basic_signatures * serialized() {
+        return static_cast<serialized_basic_signatures *>(ser_sigs);
+    }
+
     void add_preprepare(signature *insec_sig) override {
-        bls::InsecureSignature sig = ((insecure_signature *) insec_sig)->sig;
+        bls::InsecureSignature sig = static_cast<insecure_signature *>(insec_sig)->sig;
 
         uint8_t *ser_sig = new uint8_t[bls::InsecureSignature::SIGNATURE_SIZE];
         sig.Serialize(ser_sig);
@@ -29,11 +34,11 @@ public:
 
     void set_preprepare(bls::InsecureSignature &sig, uint8_t *ser_sig) {
         preprepare_sig = bls::InsecureSignature(sig);
-        ((serialized_basic_signatures *) ser_sigs)->add_preprepare(ser_sig);
+        serialized()->add_preprepare(ser_sig);
     }
 
     void add_prepare(int i, signature *insec_sig) override {
-        bls::InsecureSignature sig = ((insecure_signature *) insec_sig)->sig;
+        bls::InsecureSignature sig = static_cast<insecure_signature *>(insec_sig)->sig;
 
         uint8_t *ser_sig = new uint8_t[bls::InsecureSignature::SIGNATURE_SIZE];
         sig.Serialize(ser_sig);
@@ -43,11 +48,11 @@ public:
 
     void add_prepare(int i, bls::InsecureSignature &sig, uint8_t *ser_sig) {
         prepare_sigs.insert(std::pair<int, bls::InsecureSignature>(i, bls::InsecureSignature(sig)));
-        ((serialized_basic_signatures *) ser_sigs)->add_prepare(i, ser_sig);
+        serialized()->add_prepare(i, ser_sig);
     }
 
     void add_commit(int i, signature *insec_sig) override {
-        bls::InsecureSignature sig = ((insecure_signature *) insec_sig)->sig;
+        bls::InsecureSignature sig = static_cast<insecure_signature *>(insec_sig)->sig;
 
         uint8_t *ser_sig = new uint8_t[bls::InsecureSignature::SIGNATURE_SIZE];
         sig.Serialize(ser_sig);
@@ -57,11 +62,11 @@ public:
 
     void add_commit(int i, bls::InsecureSignature &sig, uint8_t *ser_sig) {
         commit_sigs.insert(std::pair<int, bls::InsecureSignature>(i, bls::InsecureSignature(sig)));
-        ((serialized_basic_signatures *) ser_sigs)->add_commit(i, ser_sig);
+        serialized()->add_commit(i, ser_sig);
     }
 
     void merge(basic_signatures &sigs) {
-        serialized_basic_signatures ser_sigs = *(serialized_basic_signatures *) sigs.ser_sigs;
+        serialized_basic_signatures ser_sigs = *sigs.serialized();
 
         if (sigs.preprepare_sig.has_value()) {
             set_preprepare(sigs.preprepare_sig.value(), ser_sigs.ser_preprepare_sig.value());
@@ -100,68 +105,68 @@ public:
 
     serialized_signatures * serialize() override {
         // /*
-        if (::patt == BROADCAST) {
+        if constexpr (PATT == BROADCAST) {
             if (!commit_sigs.empty()) {
                 serialized_basic_signatures *ser = new serialized_basic_signatures();
-                ser->set_commits(((serialized_basic_signatures *) ser_sigs)->ser_commit_sigs);
+                ser->set_commits(serialized()->ser_commit_sigs);
                 return ser;
             }
             else if (!prepare_sigs.empty()) {
                 serialized_basic_signatures *ser = new serialized_basic_signatures();
-                ser->set_prepares(((serialized_basic_signatures *) ser_sigs)->ser_prepare_sigs);
+                ser->set_prepares(serialized()->ser_prepare_sigs);
                 return ser;
             }
             else {
-                return new serialized_basic_signatures(*(serialized_basic_signatures *) ser_sigs);
+                return new serialized_basic_signatures(*serialized());
             }
         }
-        else if (::patt == CENTRALIZED) {
+        else if constexpr (PATT == CENTRALIZED) {
             if (committed()) {
                 serialized_basic_signatures *ser = new serialized_basic_signatures();
-                ser->set_commits(((serialized_basic_signatures *) ser_sigs)->ser_commit_sigs);
+                ser->set_commits(serialized()->ser_commit_sigs);
                 return ser;
             }
             else if (prepared()) {
                 if (contains_commit(0)) {
                     serialized_basic_signatures *ser = new serialized_basic_signatures();
-                    ser->set_prepares(((serialized_basic_signatures *) ser_sigs)->ser_prepare_sigs);
+                    ser->set_prepares(serialized()->ser_prepare_sigs);
                     return ser;
                 }
                 else {
                     serialized_basic_signatures *ser = new serialized_basic_signatures();
-                    ser->set_commits(((serialized_basic_signatures *) ser_sigs)->ser_commit_sigs);
+                    ser->set_commits(serialized()->ser_commit_sigs);
                     return ser;
                 }
             }
             else {
                 if (prepare_sigs.empty()) {
-                    return new serialized_basic_signatures(*(serialized_basic_signatures *) ser_sigs);
+                    return new serialized_basic_signatures(*serialized());
                 }
                 else {
                     serialized_basic_signatures *ser = new serialized_basic_signatures();
-                    ser->set_prepares(((serialized_basic_signatures *) ser_sigs)->ser_prepare_sigs);
+                    ser->set_prepares(serialized()->ser_prepare_sigs);
                     return ser;
                 }
             }
         }
-        else if (::patt == RING) {
-            if (!((serialized_basic_signatures *) ser_sigs)->ser_preprepare_sig.has_value()) {
+        else if constexpr (PATT == RING || PATT == BIRING) {
+            if (!serialized()->ser_preprepare_sig.has_value()) {
                 // only commits
                 serialized_basic_signatures *ser = new serialized_basic_signatures();
-                ser->set_commits(((serialized_basic_signatures *) ser_sigs)->ser_commit_sigs);
+                ser->set_commits(serialized()->ser_commit_sigs);
                 return ser;
             }
             else if (prepared() && commit_sigs.size() >= ::t + 1) {
                 // pre-prepare not necessary anymore (full round completed)
-                ((serialized_basic_signatures *) ser_sigs)->ser_preprepare_sig.reset();
-                return new serialized_basic_signatures(*(serialized_basic_signatures *) ser_sigs);
+                serialized()->ser_preprepare_sig.reset();
+                return new serialized_basic_signatures(*serialized());
             }
             else {
-                return new serialized_basic_signatures(*(serialized_basic_signatures *) ser_sigs);
+                return new serialized_basic_signatures(*serialized());
             }
         }
         // */
-        return new serialized_basic_signatures(*(serialized_basic_signatures *) ser_sigs);
+        return new serialized_basic_signatures(*serialized());
     }
 
     bool empty() {
@@ -0,0 +1,322 @@
+#ifndef MOCK_SIGNATURES_H
+#define MOCK_SIGNATURES_H
+
+#include "../arguments.h"
+#include "../bitmap.h"
+#include "../groups.h"
+#include "../signature_schemes/cost_model.h"
+#include "signatures.h"
+#include "signer_pieces.h"
+#include "../serialized_signatures/serialized_mock_signatures.h"
+
+// signer sets of proof-of-possession multi-signatures without the curve points: merged and trimmed
+// exactly like pop_multi_signatures, with every aggregation and serialization charged to the replica
+template <int PATT>
+class mock_signatures final : public signatures {
+public:
+    long *charged;
+
+    bool preprepare = false;
+    bitmap prepares;
+    bitmap commits;
+    signer_pieces<bool> prepare_pieces; // no curve points, only the sets
+    signer_pieces<bool> commit_pieces;
+
+    static constexpr bool GROUPED = PATT == HIERARCHICAL || PATT == SHARDED;
+
+    // grouped patterns, as in pop_multi_signatures
+    bitmap group_prepares;
+    bitmap group_commits;
+    bool forwarding = false;
+
+    // bidirectional ring: the pattern calls withhold_commits for a message sent both ways at once, where
+    // the own commit would end up in both flows, whose sets then never combine
+    bool withholding = false;
+
+    explicit mock_signatures(long *charged) : signatures(new serialized_mock_signatures()), charged(charged) {}
+
+    serialized_mock_signatures * serialized() {
+        return static_cast<serialized_mock_signatures *>(ser_sigs);
+    }
+
+    void add_preprepare(signature *) override {
+        ::costs.charge(*charged, cost_model::SERIALIZE);
+        set_preprepare();
+    }
+
+    void set_preprepare() {
+        preprepare = true;
+        serialized()->preprepare = true;
+    }
+
+    void add_signer(bitmap &signers, int i) {
+        if (!signers.empty()) {
+            ::costs.charge(*charged, cost_model::AGGREGATE);
+        }
+        signers.set(i);
+    }
+
+    // whether the signers grew, as in pop_multi_signatures::merge_sig
+    bool merge_signers(bitmap &signers, signer_pieces<bool> &pieces, const bitmap &new_signers) {
+        if (!pieces.adds(signers, new_signers)) {
+            return false;
+        }
+        int k = pieces.add(new_signers, true);
+        if (!signers.intersects(new_signers)) {
+            if (!signers.empty()) {
+                ::costs.charge(*charged, cost_model::AGGREGATE);
+            }
+            signers.merge(new_signers);
+            return true;
+        }
+
+        // overlapping sets cannot be combined without counting a signer twice: re-pack from disjoint pieces
+        bitmap packed;
+        std::vector<int> chosen = pieces.pack(k, packed);
+        if (packed.count() <= signers.count()) {
+            return false;
+        }
+        ::costs.charge(*charged, cost_model::AGGREGATE, (long) chosen.size() - 1);
+        signers = packed;
+        return true;
+    }
+
+    void add_group(bitmap &group, const bitmap &signers) {
+        if (!group.empty()) {
+            ::costs.charge(*charged, cost_model::AGGREGATE);
+        }
+        group.merge(signers);
+    }
+
+    bool from_group(const bitmap &signers, const bitmap &group, const bitmap &merged) {
+        if (owner != head_of(owner) || group.intersects(signers) || !merged.contains_all(signers)) {
+            return false;
+        }
+        for (int i : signers.members()) {
+            if (head_of(i) != owner) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void forward_group() {
+        forwarding = true;
+    }
+
+    void withhold_commits() {
+        withholding = true;
+    }
+
+    void add_prepare(int i, signature *) override {
+        bitmap own;
+        own.set(i);
+        add_signer(prepares, i);
+        prepare_pieces.add(own, true);
+        if constexpr (PATT == BROADCAST) {
+            ::costs.charge(*charged, cost_model::SERIALIZE);
+        }
+        if constexpr (GROUPED) {
+            group_prepares.set(i);
+        }
+    }
+
+    void add_commit(int i, signature *) override {
+        bitmap own;
+        own.set(i);
+        add_signer(commits, i);
+        commit_pieces.add(own, true);
+        if constexpr (PATT == BROADCAST) {
+            ::costs.charge(*charged, cost_model::SERIALIZE);
+        }
+        if constexpr (GROUPED) {
+            group_commits.set(i);
+        }
+    }
+
+    // whether anything was learnt
+    bool merge(mock_signatures &sigs) {
+        bool grew = false;
+        if (sigs.preprepare) {
+            set_preprepare();
+            grew = true;
+        }
+        if (!sigs.prepares.empty()) {
+            grew = merge_signers(prepares, prepare_pieces, sigs.prepares) || grew;
+            if constexpr (GROUPED) {
+                if (from_group(sigs.prepares, group_prepares, prepares)) {
+                    add_group(group_prepares, sigs.prepares);
+                }
+            }
+        }
+        if (!sigs.commits.empty()) {
+            grew = merge_signers(commits, commit_pieces, sigs.commits) || grew;
+            if constexpr (GROUPED) {
+                if (from_group(sigs.commits, group_commits, commits)) {
+                    add_group(group_commits, sigs.commits);
+                }
+            }
+        }
+        return grew;
+    }
+
+    bool contains_prepare(int i) override {
+        return prepares.test(i);
+    }
+
+    bool merges_prepares(const bitmap &new_prepares) {
+        return prepare_pieces.adds(prepares, new_prepares);
+    }
+
+    bool prepared() override {
+        return prepares.count() >= 2*::t;
+    }
+
+    bool contains_commit(int i) override {
+        return commits.test(i);
+    }
+
+    bool merges_commits(const bitmap &new_commits) {
+        return commit_pieces.adds(commits, new_commits);
+    }
+
+    bool committed() override {
+        return commits.count() >= 2*::t + 1;
+    }
+
+    signatures * clone() override {
+        return new mock_signatures(*this);
+    }
+
+    serialized_signatures * serialize() override {
+        auto own_ser_sigs = serialized();
+
+        if constexpr (PATT == BROADCAST) {
+            // own signatures only, as in pop_multi_signatures
+            auto *ser = new serialized_mock_signatures();
+            ser->preprepare = owner == 0 && !contains_commit(owner) && preprepare;
+            bitmap own;
+            own.set(owner);
+            if (contains_prepare(owner)) {
+                ser->prepares = own;
+            }
+            if (contains_commit(owner)) {
+                ser->commits = own;
+            }
+            return ser;
+        }
+
+        // serialized again only once the signers changed
+        if (!prepares.empty() && own_ser_sigs->prepares != prepares) {
+            ::costs.charge(*charged, cost_model::SERIALIZE);
+            own_ser_sigs->prepares = prepares;
+        }
+        if (!commits.empty() && own_ser_sigs->commits != commits) {
+            ::costs.charge(*charged, cost_model::SERIALIZE);
+            own_ser_sigs->commits = commits;
+        }
+
+        if constexpr (PATT == CENTRALIZED) {
+            if (committed()) {
+                auto *ser = new serialized_mock_signatures();
+                ser->commits = own_ser_sigs->commits;
+                return ser;
+            }
+            else if (prepared()) {
+                auto *ser = new serialized_mock_signatures();
+                if (contains_commit(0)) {
+                    ser->prepares = own_ser_sigs->prepares;
+                }
+                else {
+                    ser->commits = own_ser_sigs->commits;
+                }
+                return ser;
+            }
+            else if (!prepares.empty()) {
+                auto *ser = new serialized_mock_signatures();
+                ser->prepares = own_ser_sigs->prepares;
+                return ser;
+            }
+        }
+        else if constexpr (PATT == RING || PATT == BIRING) {
+            if (withholding) {
+                withholding = false;
+                auto *ser = new serialized_mock_signatures(*own_ser_sigs);
+                ser->commits.reset();
+                return ser;
+            }
+            if (!own_ser_sigs->preprepare) {
+                // only commits
+                auto *ser = new serialized_mock_signatures();
+                ser->commits = own_ser_sigs->commits;
+                return ser;
+            }
+            else if (prepared() && commits.count() >= ::t + 1) {
+                // pre-prepare not necessary anymore (full round completed)
+                own_ser_sigs->preprepare = false;
+            }
+        }
+        else if constexpr (PATT == GOSSIP) {
+            if (commits.count() == 3*::t + 1) {
+                auto *ser = new serialized_mock_signatures();
+                ser->commits = own_ser_sigs->commits;
+                return ser;
+            }
+            else if (prepares.count() == 3*::t) {
+                auto *ser = new serialized_mock_signatures();
+                ser->prepares = own_ser_sigs->prepares;
+                ser->commits = own_ser_sigs->commits;
+                return ser;
+            }
+        }
+        else if constexpr (GROUPED) {
+            auto *ser = new serialized_mock_signatures();
+            if (owner != head_of(owner)) {
+                // members only send their own signatures, to their head which has all the rest
+                if (!group_commits.empty()) {
+                    ::costs.charge(*charged, cost_model::SERIALIZE);
+                    ser->commits = group_commits;
+                }
+                else if (!group_prepares.empty()) {
+                    ::costs.charge(*charged, cost_model::SERIALIZE);
+                    ser->prepares = group_prepares;
+                }
+                return ser;
+            }
+
+            if (committed()) {
+                ser->commits = own_ser_sigs->commits;
+                return ser;
+            }
+            if (prepared()) {
+                // the group had the pre-prepare from its head, the other heads from the leader
+                ser->prepares = own_ser_sigs->prepares;
+            }
+            else {
+                ser->preprepare = own_ser_sigs->preprepare;
+            }
+            if (forwarding) {
+                if (!prepared() && !group_prepares.empty()) {
+                    ::costs.charge(*charged, cost_model::SERIALIZE);
+                    ser->prepares = group_prepares;
+                }
+                if (!group_commits.empty()) {
+                    ::costs.charge(*charged, cost_model::SERIALIZE);
+                    ser->commits = group_commits;
+                }
+                group_prepares = bitmap();
+                group_commits = bitmap();
+                forwarding = false;
+            }
+            return ser;
+        }
+
+        return new serialized_mock_signatures(*own_ser_sigs);
+    }
+
+    bool empty() {
+        return !preprepare && prepares.empty() && commits.empty();
+    }
+};
+
+#endif
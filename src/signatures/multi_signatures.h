@@ -2,6 +2,7 @@
 #define MULTI_SIGNATURES_H
 
 #include <aggregationinfo.hpp>
+#include <chrono>
 #include <optional>
 #include <publickey.hpp>
 #include <unordered_set>
@@ -10,11 +11,16 @@
 #include <signature.hpp>
 
 #include "../arguments.h"
+#include "../groups.h"
 #include "../l_tree.h"
+#include "../signature_schemes/aggregated_public_keys.h"
+#include "adaptive_evaluation.h"
+#include "background_fold.h"
 #include "signatures.h"
 #include "../serialized_signatures/serialized_multi_signatures.h"
 
-class multi_signatures : public signatures {
+template <int PATT, int EVAL, int AGG>
+class multi_signatures final : public signatures {
 public:
     std::optional<bls::InsecureSignature> preprepare_sig;
 
@@ -22,21 +28,42 @@ public:
     std::vector<bls::Signature> pending_prepares_sigs;
     std::optional<l_tree<int>> prepares_order;
     std::vector<l_tree<int>> pending_prepares_orders;
+    background_fold<int> prepares_fold;
+    adaptive_evaluation prepares_eval;
 
     std::optional<bls::Signature> commit_multisig;
     std::vector<bls::Signature> pending_commits_sigs;
     std::optional<l_tree<int>> commits_order;
     std::vector<l_tree<int>> pending_commits_orders;
+    background_fold<int> commits_fold;
+    adaptive_evaluation commits_eval;
 
     std::unordered_set<int> prepares;
     std::unordered_set<int> commits;
 
-    multi_signatures() : signatures(new serialized_multi_signatures()) {}
+    // multisigs aggregated since they were last serialized
+    bool prepares_changed = false;
+    bool commits_changed = false;
+
+    aggregated_public_keys *agg_pks;
+
+    explicit multi_signatures(aggregated_public_keys *agg_pks) : signatures(new serialized_multi_signatures()), agg_pks(agg_pks) {}
+
+    serialized_multi_signatures * serialized() {
+        return static_cast<serialized_multi_signatures *>(ser_sigs);
+    }
+
+    // with PKAGG an aggregate carries the aggregation info of its aggregated key only, as if that key signed it
+    static void collapse(aggregated_public_keys *agg_pks, bls::Signature &multisig, l_tree<int> &order, int phase) {
+        if constexpr (AGG == PKAGG) {
+            multisig.SetAggregationInfo(bls::AggregationInfo::FromMsgHash(agg_pks->aggregated_pk(order), agg_pks->pks->hash(phase)));
+        }
+    }
 
     void add_preprepare(signature *sec_sig) override {
-        bls::InsecureSignature sig = ((insecure_signature *) sec_sig)->sig;
+        bls::InsecureSignature sig = static_cast<insecure_signature *>(sec_sig)->sig;
 
-        uint8_t *ser_sig = new uint8_t[bls::Signature::SIGNATURE_SIZE];
+        uint8_t *ser_sig = buffer(bls::Signature::SIGNATURE_SIZE);
         sig.Serialize(ser_sig);
 
         set_preprepare(sig, ser_sig);
@@ -44,37 +71,57 @@ public:
 
     void set_preprepare(bls::InsecureSignature &sig, uint8_t *ser_sig) {
         preprepare_sig = bls::InsecureSignature(sig);
-        ((serialized_multi_signatures *) ser_sigs)->add_preprepare(ser_sig);
+        serialized()->add_preprepare(ser_sig);
     }
 
     void add_prepare(bls::Signature &sig, const l_tree<int>& order) {
-        if (::eval == EAGER) {
-            if (!prepare_multisig.has_value()) {
-                prepare_multisig = bls::Signature(sig);
-                prepares_order = l_tree<int>(order);
+        if constexpr (EVAL == EAGER) {
+            aggregate_prepare(sig, order);
+        }
+        else if constexpr (EVAL == ADAPTIVE) {
+            if (prepares_eval.arrival()) {
+                aggregate_prepare(sig, order);
             }
             else {
-                prepare_multisig = bls::Signature(bls::Signature::Aggregate({prepare_multisig.value(), sig}));
-                if (::agg == PKAGG) {
-                    std::vector<bls::PublicKey> pks = prepare_multisig.value().GetAggregationInfo()->GetPubKeys();
-                    uint8_t prepare[1] = {1};
-                    prepare_multisig.value().SetAggregationInfo(bls::AggregationInfo::FromMsg(bls::PublicKey::Aggregate(pks), prepare, sizeof(prepare)));
-                }
-                prepares_order = l_tree<int>((std::vector<l_tree<int>>) {prepares_order.value(), order});
+                pending_prepares_sigs.push_back(sig);
+                pending_prepares_orders.push_back(order);
             }
         }
-        else if (::eval == LAZY) {
+        else if constexpr (EVAL == LAZY || EVAL == BACKGROUND) {
             pending_prepares_sigs.push_back(sig);
             pending_prepares_orders.push_back(order);
+            if constexpr (EVAL == BACKGROUND) {
+                prepares_fold.add(pending_prepares_sigs, pending_prepares_orders, [agg_pks = agg_pks](bls::Signature &folded, l_tree<int> &order) {
+                    collapse(agg_pks, folded, order, 1);
+                });
+            }
+        }
+    }
+
+    void aggregate_prepare(bls::Signature &sig, const l_tree<int>& order) {
+        prepares_changed = true;
+        if (!prepare_multisig.has_value()) {
+            prepare_multisig = bls::Signature(sig);
+            prepares_order = l_tree<int>(order);
+        }
+        else {
+            auto started = std::chrono::steady_clock::now();
+            prepare_multisig = bls::Signature(bls::Signature::Aggregate({prepare_multisig.value(), sig}));
+            prepares_order = l_tree<int>((std::vector<l_tree<int>>) {prepares_order.value(), order});
+            collapse(agg_pks, prepare_multisig.value(), prepares_order.value(), 1);
+            if constexpr (EVAL == ADAPTIVE) {
+                prepares_eval.measured(1, started);
+            }
         }
     }
 
     void add_prepare(int i, signature *sec_sig) override {
-        add_prepare(((secure_signature *) sec_sig)->sig, l_tree(i));
+        add_prepare(static_cast<secure_signature *>(sec_sig)->sig, l_tree(i));
         prepares.insert(i);
     }
 
     void set_prepares(bls::Signature &multisig, l_tree<int> &new_prepares_order, std::unordered_set<int> new_prepares) {
+        prepares_changed = true;
         prepare_multisig = bls::Signature(multisig);
         prepares_order = l_tree<int>(new_prepares_order);
         prepares.insert(new_prepares.begin(), new_prepares.end());
@@ -86,33 +133,53 @@ public:
     }
 
     void add_commit(bls::Signature &sig, const l_tree<int>& order) {
-        if (::eval == EAGER) {
-            if (!commit_multisig.has_value()) {
-                commit_multisig = bls::Signature(sig);
-                commits_order = l_tree<int>(order);
+        if constexpr (EVAL == EAGER) {
+            aggregate_commit(sig, order);
+        }
+        else if constexpr (EVAL == ADAPTIVE) {
+            if (commits_eval.arrival()) {
+                aggregate_commit(sig, order);
             }
             else {
-                commit_multisig = bls::Signature(bls::Signature::Aggregate({commit_multisig.value(), sig}));
-                if (::agg == PKAGG) {
-                    std::vector<bls::PublicKey> pks = commit_multisig.value().GetAggregationInfo()->GetPubKeys();
-                    uint8_t commit[1] = {2};
-                    commit_multisig.value().SetAggregationInfo(bls::AggregationInfo::FromMsg(bls::PublicKey::Aggregate(pks), commit, sizeof(commit)));
-                }
-                commits_order = l_tree<int>((std::vector<l_tree<int>>) {commits_order.value(), order});
+                pending_commits_sigs.push_back(sig);
+                pending_commits_orders.push_back(order);
             }
         }
-        else if (::eval == LAZY) {
+        else if constexpr (EVAL == LAZY || EVAL == BACKGROUND) {
             pending_commits_sigs.push_back(sig);
             pending_commits_orders.push_back(order);
+            if constexpr (EVAL == BACKGROUND) {
+                commits_fold.add(pending_commits_sigs, pending_commits_orders, [agg_pks = agg_pks](bls::Signature &folded, l_tree<int> &order) {
+                    collapse(agg_pks, folded, order, 2);
+                });
+            }
+        }
+    }
+
+    void aggregate_commit(bls::Signature &sig, const l_tree<int>& order) {
+        commits_changed = true;
+        if (!commit_multisig.has_value()) {
+            commit_multisig = bls::Signature(sig);
+            commits_order = l_tree<int>(order);
+        }
+        else {
+            auto started = std::chrono::steady_clock::now();
+            commit_multisig = bls::Signature(bls::Signature::Aggregate({commit_multisig.value(), sig}));
+            commits_order = l_tree<int>((std::vector<l_tree<int>>) {commits_order.value(), order});
+            collapse(agg_pks, commit_multisig.value(), commits_order.value(), 2);
+            if constexpr (EVAL == ADAPTIVE) {
+                commits_eval.measured(1, started);
+            }
         }
     }
 
     void add_commit(int i, signature *sec_sig) override {
-        add_commit(((secure_signature *) sec_sig)->sig, l_tree(i));
+        add_commit(static_cast<secure_signature *>(sec_sig)->sig, l_tree(i));
         commits.insert(i);
     }
 
     void set_commits(bls::Signature &multisig, l_tree<int> &new_commits_order, std::unordered_set<int> new_commits) {
+        commits_changed = true;
         commit_multisig = bls::Signature(multisig);
         commits_order = l_tree<int>(new_commits_order);
         commits.insert(new_commits.begin(), new_commits.end());
@@ -124,7 +191,7 @@ public:
     }
 
     void merge(multi_signatures &sigs) {
-        serialized_multi_signatures ser_sigs = *(serialized_multi_signatures *) sigs.ser_sigs;
+        serialized_multi_signatures ser_sigs = *sigs.serialized();
 
         if (sigs.preprepare_sig.has_value()) {
             set_preprepare(sigs.preprepare_sig.value(), ser_sigs.ser_preprepare_sig.value());
@@ -182,8 +249,14 @@ public:
     }
 
     serialized_signatures * serialize() override {
-        if (::eval == LAZY) {
+        if constexpr (EVAL == BACKGROUND) {
+            prepares_fold.finish(pending_prepares_sigs, pending_prepares_orders);
+            commits_fold.finish(pending_commits_sigs, pending_commits_orders);
+        }
+        if constexpr (EVAL == LAZY || EVAL == BACKGROUND || EVAL == ADAPTIVE) {
             if (!pending_prepares_sigs.empty()) {
+                auto started = std::chrono::steady_clock::now();
+                size_t count = pending_prepares_sigs.size();
                 if (prepare_multisig.has_value()) {
                     pending_prepares_sigs.push_back(prepare_multisig.value());
                 }
@@ -193,11 +266,8 @@ public:
                 }
                 else /*if (pending_prepares_sigs.size() > 1)*/ {
                     prepare_multisig = bls::Signature(bls::Signature::Aggregate(pending_prepares_sigs));
-
-                    if (::agg == PKAGG) {
-                        std::vector<bls::PublicKey> pks = prepare_multisig.value().GetAggregationInfo()->GetPubKeys();
-                        uint8_t prepare[1] = {1};
-                        prepare_multisig.value().SetAggregationInfo(bls::AggregationInfo::FromMsg(bls::PublicKey::Aggregate(pks), prepare, sizeof(prepare)));
+                    if constexpr (EVAL == ADAPTIVE) {
+                        prepares_eval.measured(count, started);
                     }
                 }
                 pending_prepares_sigs.clear();
@@ -213,16 +283,16 @@ public:
                 }
                 else /*if (pending_prepares_orders.size() > 1)*/ {
                     prepares_order = l_tree<int>(pending_prepares_orders);
+
+                    collapse(agg_pks, prepare_multisig.value(), prepares_order.value(), 1);
                 }
                 pending_prepares_orders.clear();
-
-
-                uint8_t *ser_prepare_multisig = new uint8_t[bls::Signature::SIGNATURE_SIZE];
-                prepare_multisig.value().Serialize(ser_prepare_multisig);
-                ((serialized_multi_signatures *) ser_sigs)->update_prepares(ser_prepare_multisig, prepares_order.value(), prepares);
+                prepares_changed = true;
             }
 
             if (!pending_commits_sigs.empty()) {
+                auto started = std::chrono::steady_clock::now();
+                size_t count = pending_commits_sigs.size();
                 if (commit_multisig.has_value()) {
                     pending_commits_sigs.push_back(commit_multisig.value());
                 }
@@ -232,11 +302,8 @@ public:
                 }
                 else /*if (pending_commits_sigs.size() > 1)*/ {
                     commit_multisig = bls::Signature(bls::Signature::Aggregate(pending_commits_sigs));
-
-                    if (::agg == PKAGG) {
-                        std::vector<bls::PublicKey> pks = commit_multisig.value().GetAggregationInfo()->GetPubKeys();
-                        uint8_t commit[1] = {2};
-                        commit_multisig.value().SetAggregationInfo(bls::AggregationInfo::FromMsg(bls::PublicKey::Aggregate(pks), commit, sizeof(commit)));
+                    if constexpr (EVAL == ADAPTIVE) {
+                        commits_eval.measured(count, started);
                     }
                 }
                 pending_commits_sigs.clear();
@@ -252,94 +319,126 @@ public:
                 }
                 else /*if (pending_prepares_orders.size() > 1)*/ {
                     commits_order = l_tree<int>(pending_commits_orders);
+
+                    collapse(agg_pks, commit_multisig.value(), commits_order.value(), 2);
                 }
                 pending_commits_orders.clear();
-
-                uint8_t *ser_commit_multisig = new uint8_t[bls::Signature::SIGNATURE_SIZE];
-                commit_multisig.value().Serialize(ser_commit_multisig);
-                ((serialized_multi_signatures *) ser_sigs)->update_commits(ser_commit_multisig, commits_order.value(), commits);
+                commits_changed = true;
             }
         }
 
-        if (::eval == EAGER && prepare_multisig.has_value()) {
-            uint8_t *ser_prepare_multisig = new uint8_t[bls::Signature::SIGNATURE_SIZE];
+        // one path for every evaluation: a multisig is serialized once after it changed, however it was aggregated
+        if (prepares_changed) {
+            uint8_t *ser_prepare_multisig = buffer(bls::Signature::SIGNATURE_SIZE);
             prepare_multisig.value().Serialize(ser_prepare_multisig);
-            ((serialized_multi_signatures *) ser_sigs)->update_prepares(ser_prepare_multisig, prepares_order.value(), prepares);
+            serialized()->update_prepares(ser_prepare_multisig, prepares_order.value(), prepares);
+            prepares_changed = false;
         }
-        if (::eval == EAGER && commit_multisig.has_value()) {
-            uint8_t *ser_commit_multisig = new uint8_t[bls::Signature::SIGNATURE_SIZE];
+        if (commits_changed) {
+            uint8_t *ser_commit_multisig = buffer(bls::Signature::SIGNATURE_SIZE);
             commit_multisig.value().Serialize(ser_commit_multisig);
-            ((serialized_multi_signatures *) ser_sigs)->update_commits(ser_commit_multisig, commits_order.value(), commits);
+            serialized()->update_commits(ser_commit_multisig, commits_order.value(), commits);
+            commits_changed = false;
         }
 
-        if (::patt == CENTRALIZED) {
+        if constexpr (PATT == CENTRALIZED) {
             if (committed()) {
                 serialized_multi_signatures *ser = new serialized_multi_signatures();
-                ser->set_commit_multisig(((serialized_multi_signatures *) ser_sigs)->ser_commit_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->commits_order.value(), ((serialized_multi_signatures *) ser_sigs)->commits);
+                ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
                 return ser;
             }
             else if (prepared()) {
                 if (contains_commit(0)) {
                     serialized_multi_signatures *ser = new serialized_multi_signatures();
-                    ser->set_prepare_multisig(((serialized_multi_signatures *) ser_sigs)->ser_prepare_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->prepares_order.value(), ((serialized_multi_signatures *) ser_sigs)->prepares);
+                    ser->set_prepare_multisig(serialized()->ser_prepare_multisig.value(), serialized()->prepares_order.value(), serialized()->prepares);
                     return ser;
                 }
                 else {
                     serialized_multi_signatures *ser = new serialized_multi_signatures();
-                    ser->set_commit_multisig(((serialized_multi_signatures *) ser_sigs)->ser_commit_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->commits_order.value(), ((serialized_multi_signatures *) ser_sigs)->commits);
+                    ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
                     return ser;
                 }
             }
             else {
                 if (prepares.empty()) {
-                    return new serialized_multi_signatures(*(serialized_multi_signatures *) ser_sigs);
+                    return new serialized_multi_signatures(*serialized());
                 }
                 else {
                     serialized_multi_signatures *ser = new serialized_multi_signatures();
-                    ser->set_prepare_multisig(((serialized_multi_signatures *) ser_sigs)->ser_prepare_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->prepares_order.value(), ((serialized_multi_signatures *) ser_sigs)->prepares);
+                    ser->set_prepare_multisig(serialized()->ser_prepare_multisig.value(), serialized()->prepares_order.value(), serialized()->prepares);
                     return ser;
                 }
             }
         }
-        else if (::patt == RING) {
-            if (!((serialized_multi_signatures *) ser_sigs)->ser_preprepare_sig.has_value()) {
+        else if constexpr (PATT == RING || PATT == BIRING) {
+            if (!serialized()->ser_preprepare_sig.has_value()) {
                 // only commits
                 serialized_multi_signatures *ser = new serialized_multi_signatures();
-                ser->set_commit_multisig(((serialized_multi_signatures *) ser_sigs)->ser_commit_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->commits_order.value(), ((serialized_multi_signatures *) ser_sigs)->commits);
+                ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
                 return ser;
             }
             else if (prepared() && commits.size() >= ::t + 1) {
                 // pre-prepare not necessary anymore (full round completed)
-                ((serialized_multi_signatures *) ser_sigs)->ser_preprepare_sig.reset();
-                return new serialized_multi_signatures(*(serialized_multi_signatures *) ser_sigs);
+                serialized()->ser_preprepare_sig.reset();
+                return new serialized_multi_signatures(*serialized());
             }
             else {
-                return new serialized_multi_signatures(*(serialized_multi_signatures *) ser_sigs);
+                return new serialized_multi_signatures(*serialized());
             }
         }
-        else if (::patt == GOSSIP) {
+        else if constexpr (PATT == GOSSIP) {
             if (commits.size() == 3*::t + 1) {
                 serialized_multi_signatures *ser = new serialized_multi_signatures();
-                ser->set_commit_multisig(((serialized_multi_signatures *) ser_sigs)->ser_commit_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->commits_order.value(), ((serialized_multi_signatures *) ser_sigs)->commits);
+                ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
                 return ser;
             }
             else if (prepares.size() == 3*::t) {
                 serialized_multi_signatures *ser = new serialized_multi_signatures();
-                ser->set_prepare_multisig(((serialized_multi_signatures *) ser_sigs)->ser_prepare_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->prepares_order.value(), ((serialized_multi_signatures *) ser_sigs)->prepares);
-                ser->set_commit_multisig(((serialized_multi_signatures *) ser_sigs)->ser_commit_multisig.value(), ((serialized_multi_signatures *) ser_sigs)->commits_order.value(), ((serialized_multi_signatures *) ser_sigs)->commits);
+                ser->set_prepare_multisig(serialized()->ser_prepare_multisig.value(), serialized()->prepares_order.value(), serialized()->prepares);
+                ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
                 return ser;
 
             }
             else {
-                return new serialized_multi_signatures(*(serialized_multi_signatures *) ser_sigs);
+                return new serialized_multi_signatures(*serialized());
+            }
+        }
+        else if constexpr (PATT == HIERARCHICAL || PATT == SHARDED) {
+            if (owner != head_of(owner)) {
+                // members only send to their head, which already has everything but their own signatures
+                if (prepared()) {
+                    serialized_multi_signatures *ser = new serialized_multi_signatures();
+                    ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
+                    return ser;
+                }
+                else if (!prepares.empty()) {
+                    serialized_multi_signatures *ser = new serialized_multi_signatures();
+                    ser->set_prepare_multisig(serialized()->ser_prepare_multisig.value(), serialized()->prepares_order.value(), serialized()->prepares);
+                    return ser;
+                }
+            }
+            else if (committed()) {
+                serialized_multi_signatures *ser = new serialized_multi_signatures();
+                ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
+                return ser;
+            }
+            else if (prepared()) {
+                // the group had the pre-prepare from its head, the other heads from the leader
+                serialized_multi_signatures *ser = new serialized_multi_signatures();
+                ser->set_prepare_multisig(serialized()->ser_prepare_multisig.value(), serialized()->prepares_order.value(), serialized()->prepares);
+                if (serialized()->ser_commit_multisig.has_value()) {
+                    ser->set_commit_multisig(serialized()->ser_commit_multisig.value(), serialized()->commits_order.value(), serialized()->commits);
+                }
+                return ser;
             }
         }
 
-        return new serialized_multi_signatures(*(serialized_multi_signatures *) ser_sigs);
+        return new serialized_multi_signatures(*serialized());
     }
 
     bool empty() {
-        return !preprepare_sig.has_value() && !prepare_multisig.has_value() && pending_prepares_sigs.empty() && !commit_multisig.has_value() && pending_commits_sigs.empty();
+        return !preprepare_sig.has_value() && !prepare_multisig.has_value() && pending_prepares_sigs.empty() && !prepares_fold.running.has_value()
+            && !commit_multisig.has_value() && pending_commits_sigs.empty() && !commits_fold.running.has_value();
     }
 };
 
@@ -0,0 +1,405 @@
+#ifndef POP_MULTI_SIGNATURES_H
+#define POP_MULTI_SIGNATURES_H
+
+#include <optional>
+#include <vector>
+
+#include <signature.hpp>
+
+#include "../arguments.h"
+#include "../bitmap.h"
+#include "../groups.h"
+#include "signatures.h"
+#include "signer_pieces.h"
+#include "../serialized_signatures/serialized_pop_multi_signatures.h"
+
+// keys are registered with a proof of possession, so multi-signatures are plain (insecure) aggregates
+// and the signers are just a bitmap; aggregates are only combined over disjoint signer sets, from the
+// pieces received so far (signer_pieces)
+template <int PATT, int EVAL>
+class pop_multi_signatures final : public signatures {
+public:
+    std::optional<bls::InsecureSignature> preprepare_sig;
+
+    std::optional<bls::InsecureSignature> prepare_multisig;
+    std::vector<bls::InsecureSignature> pending_prepares_sigs;
+    bitmap prepares;
+    signer_pieces<bls::InsecureSignature> prepare_pieces;
+
+    std::optional<bls::InsecureSignature> commit_multisig;
+    std::vector<bls::InsecureSignature> pending_commits_sigs;
+    bitmap commits;
+    signer_pieces<bls::InsecureSignature> commit_pieces;
+
+    // broadcast: the own signatures, serialized once
+    std::optional<uint8_t *> ser_own_prepare;
+    std::optional<uint8_t *> ser_own_commit;
+
+    static constexpr bool GROUPED = PATT == HIERARCHICAL || PATT == SHARDED;
+
+    // grouped patterns: signatures of the group not sent up to the other heads yet (only its own for a
+    // member), so that heads only exchange disjoint sets; the pattern calls forward_group for a message up
+    std::optional<bls::InsecureSignature> group_prepare_sig;
+    bitmap group_prepares;
+    std::optional<bls::InsecureSignature> group_commit_sig;
+    bitmap group_commits;
+    bool forwarding = false;
+
+    // bidirectional ring: the pattern calls withhold_commits for a message sent both ways at once, where
+    // the own commit would end up in both flows, whose sets then never combine
+    bool withholding = false;
+
+    pop_multi_signatures() : signatures(new serialized_pop_multi_signatures()) {}
+
+    serialized_pop_multi_signatures * serialized() {
+        return static_cast<serialized_pop_multi_signatures *>(ser_sigs);
+    }
+
+    void add_preprepare(signature *insec_sig) override {
+        bls::InsecureSignature sig = static_cast<insecure_signature *>(insec_sig)->sig;
+
+        uint8_t *ser_sig = buffer(bls::InsecureSignature::SIGNATURE_SIZE);
+        sig.Serialize(ser_sig);
+
+        set_preprepare(sig, ser_sig);
+    }
+
+    void set_preprepare(bls::InsecureSignature &sig, uint8_t *ser_sig) {
+        preprepare_sig = bls::InsecureSignature(sig);
+        serialized()->add_preprepare(ser_sig);
+    }
+
+    static void add_sig(std::optional<bls::InsecureSignature> &multisig, std::vector<bls::InsecureSignature> &pending_sigs, bls::InsecureSignature &sig) {
+        // insecure aggregation is cheaper than any arrival gap, so ADAPTIVE always settles on EAGER
+        if constexpr (EVAL == EAGER || EVAL == ADAPTIVE) {
+            if (!multisig.has_value()) {
+                multisig = bls::InsecureSignature(sig);
+            }
+            else {
+                multisig = bls::InsecureSignature::Aggregate({multisig.value(), sig});
+            }
+        }
+        else if constexpr (EVAL == LAZY || EVAL == BACKGROUND) {
+            // insecure aggregation is a few point additions, not worth a worker round trip
+            pending_sigs.push_back(sig);
+        }
+    }
+
+    // whether the signers grew: an overlapping set may only be kept as a piece for a later re-pack
+    bool merge_sig(std::optional<bls::InsecureSignature> &multisig, std::vector<bls::InsecureSignature> &pending_sigs, bitmap &signers,
+            signer_pieces<bls::InsecureSignature> &pieces, bls::InsecureSignature &new_multisig, const bitmap &new_signers) {
+        if (!pieces.adds(signers, new_signers)) {
+            return false;
+        }
+        int k = pieces.add(new_signers, new_multisig);
+        if (!signers.intersects(new_signers)) {
+            add_sig(multisig, pending_sigs, new_multisig);
+            signers.merge(new_signers);
+            return true;
+        }
+
+        // overlapping sets cannot be combined without counting a signer twice: re-pack from disjoint pieces
+        bitmap packed;
+        std::vector<int> chosen = pieces.pack(k, packed);
+        if (packed.count() <= signers.count()) {
+            return false;
+        }
+        std::vector<bls::InsecureSignature> packed_sigs;
+        for (int j : chosen) {
+            packed_sigs.push_back(pieces.sigs.at(j));
+        }
+        multisig = packed_sigs.size() == 1 ? packed_sigs.at(0) : bls::InsecureSignature::Aggregate(packed_sigs);
+        pending_sigs.clear();
+        signers = packed;
+        return true;
+    }
+
+    static void fold(std::optional<bls::InsecureSignature> &multisig, std::vector<bls::InsecureSignature> &pending_sigs) {
+        if (!pending_sigs.empty()) {
+            if (multisig.has_value()) {
+                pending_sigs.push_back(multisig.value());
+            }
+            if (pending_sigs.size() == 1) {
+                multisig = bls::InsecureSignature(pending_sigs.at(0));
+            }
+            else {
+                multisig = bls::InsecureSignature::Aggregate(pending_sigs);
+            }
+            pending_sigs.clear();
+        }
+    }
+
+    static void add_group(std::optional<bls::InsecureSignature> &group_sig, bitmap &group, bls::InsecureSignature &sig, const bitmap &signers) {
+        if (!group_sig.has_value()) {
+            group_sig = bls::InsecureSignature(sig);
+        }
+        else {
+            group_sig = bls::InsecureSignature::Aggregate({group_sig.value(), sig});
+        }
+        group.merge(signers);
+    }
+
+    // received signers, just merged, that a head adds to its group's: members of its group only
+    bool from_group(const bitmap &signers, const bitmap &group, const bitmap &merged) {
+        if (owner != head_of(owner) || group.intersects(signers) || !merged.contains_all(signers)) {
+            return false;
+        }
+        for (int i : signers.members()) {
+            if (head_of(i) != owner) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void forward_group() {
+        forwarding = true;
+    }
+
+    void withhold_commits() {
+        withholding = true;
+    }
+
+    void add_prepare(int i, signature *insec_sig) override {
+        bls::InsecureSignature &sig = static_cast<insecure_signature *>(insec_sig)->sig;
+        bitmap own;
+        own.set(i);
+        add_sig(prepare_multisig, pending_prepares_sigs, sig);
+        prepares.set(i);
+        prepare_pieces.add(own, sig);
+        if constexpr (GROUPED) {
+            add_group(group_prepare_sig, group_prepares, sig, own);
+        }
+        if constexpr (PATT == BROADCAST) {
+            ser_own_prepare = serialized_sig(sig);
+        }
+    }
+
+    void set_prepares(bls::InsecureSignature &multisig, const bitmap &new_prepares) {
+        prepare_multisig = bls::InsecureSignature(multisig);
+        prepares = new_prepares;
+    }
+
+    void add_commit(int i, signature *insec_sig) override {
+        bls::InsecureSignature &sig = static_cast<insecure_signature *>(insec_sig)->sig;
+        bitmap own;
+        own.set(i);
+        add_sig(commit_multisig, pending_commits_sigs, sig);
+        commits.set(i);
+        commit_pieces.add(own, sig);
+        if constexpr (GROUPED) {
+            add_group(group_commit_sig, group_commits, sig, own);
+        }
+        if constexpr (PATT == BROADCAST) {
+            ser_own_commit = serialized_sig(sig);
+        }
+    }
+
+    void set_commits(bls::InsecureSignature &multisig, const bitmap &new_commits) {
+        commit_multisig = bls::InsecureSignature(multisig);
+        commits = new_commits;
+    }
+
+    // whether anything was learnt
+    bool merge(pop_multi_signatures &sigs) {
+        serialized_pop_multi_signatures ser_sigs = *sigs.serialized();
+        bool grew = false;
+
+        if (sigs.preprepare_sig.has_value()) {
+            set_preprepare(sigs.preprepare_sig.value(), ser_sigs.ser_preprepare_sig.value());
+            grew = true;
+        }
+        if (sigs.prepare_multisig.has_value()) {
+            grew = merge_sig(prepare_multisig, pending_prepares_sigs, prepares, prepare_pieces, sigs.prepare_multisig.value(), sigs.prepares) || grew;
+            if constexpr (GROUPED) {
+                if (from_group(sigs.prepares, group_prepares, prepares)) {
+                    add_group(group_prepare_sig, group_prepares, sigs.prepare_multisig.value(), sigs.prepares);
+                }
+            }
+        }
+        if (sigs.commit_multisig.has_value()) {
+            grew = merge_sig(commit_multisig, pending_commits_sigs, commits, commit_pieces, sigs.commit_multisig.value(), sigs.commits) || grew;
+            if constexpr (GROUPED) {
+                if (from_group(sigs.commits, group_commits, commits)) {
+                    add_group(group_commit_sig, group_commits, sigs.commit_multisig.value(), sigs.commits);
+                }
+            }
+        }
+        return grew;
+    }
+
+    bool contains_prepare(int i) override {
+        return prepares.test(i);
+    }
+
+    bool merges_prepares(const bitmap &new_prepares) {
+        return prepare_pieces.adds(prepares, new_prepares);
+    }
+
+    bool prepared() override {
+        return prepares.count() >= 2*::t;
+    }
+
+    bool contains_commit(int i) override {
+        return commits.test(i);
+    }
+
+    bool merges_commits(const bitmap &new_commits) {
+        return commit_pieces.adds(commits, new_commits);
+    }
+
+    bool committed() override {
+        return commits.count() >= 2*::t + 1;
+    }
+
+    signatures * clone() override {
+        return new pop_multi_signatures(*this);
+    }
+
+    uint8_t * serialized_sig(bls::InsecureSignature &sig) {
+        uint8_t *ser_sig = buffer(bls::InsecureSignature::SIGNATURE_SIZE);
+        sig.Serialize(ser_sig);
+        return ser_sig;
+    }
+
+    serialized_signatures * serialize() override {
+        auto own_ser_sigs = serialized();
+
+        if constexpr (PATT == BROADCAST) {
+            // every replica sends to all the others, so its own signatures are all they need from it (and
+            // they never overlap what the others send); the leader's first message is the pre-prepare
+            serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+            if (owner == 0 && !ser_own_commit.has_value() && own_ser_sigs->ser_preprepare_sig.has_value()) {
+                ser->add_preprepare(own_ser_sigs->ser_preprepare_sig.value());
+            }
+            bitmap own;
+            own.set(owner);
+            if (ser_own_prepare.has_value()) {
+                ser->set_prepare_multisig(ser_own_prepare.value(), own);
+            }
+            if (ser_own_commit.has_value()) {
+                ser->set_commit_multisig(ser_own_commit.value(), own);
+            }
+            return ser;
+        }
+
+        fold(prepare_multisig, pending_prepares_sigs);
+        fold(commit_multisig, pending_commits_sigs);
+
+        // the signers determine the multisig, so it is only serialized again once they changed
+        if (prepare_multisig.has_value() && !(own_ser_sigs->ser_prepare_multisig.has_value() && own_ser_sigs->prepares == prepares)) {
+            uint8_t *ser_prepare_multisig = buffer(bls::InsecureSignature::SIGNATURE_SIZE);
+            prepare_multisig.value().Serialize(ser_prepare_multisig);
+            own_ser_sigs->set_prepare_multisig(ser_prepare_multisig, prepares);
+        }
+        if (commit_multisig.has_value() && !(own_ser_sigs->ser_commit_multisig.has_value() && own_ser_sigs->commits == commits)) {
+            uint8_t *ser_commit_multisig = buffer(bls::InsecureSignature::SIGNATURE_SIZE);
+            commit_multisig.value().Serialize(ser_commit_multisig);
+            own_ser_sigs->set_commit_multisig(ser_commit_multisig, commits);
+        }
+
+        if constexpr (PATT == CENTRALIZED) {
+            if (committed()) {
+                serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+                ser->set_commit_multisig(own_ser_sigs->ser_commit_multisig.value(), own_ser_sigs->commits);
+                return ser;
+            }
+            else if (prepared()) {
+                serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+                if (contains_commit(0)) {
+                    ser->set_prepare_multisig(own_ser_sigs->ser_prepare_multisig.value(), own_ser_sigs->prepares);
+                }
+                else {
+                    ser->set_commit_multisig(own_ser_sigs->ser_commit_multisig.value(), own_ser_sigs->commits);
+                }
+                return ser;
+            }
+            else if (!prepares.empty()) {
+                serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+                ser->set_prepare_multisig(own_ser_sigs->ser_prepare_multisig.value(), own_ser_sigs->prepares);
+                return ser;
+            }
+        }
+        else if constexpr (PATT == RING || PATT == BIRING) {
+            if (withholding) {
+                withholding = false;
+                auto *ser = new serialized_pop_multi_signatures(*own_ser_sigs);
+                ser->ser_commit_multisig.reset();
+                ser->commits = bitmap();
+                return ser;
+            }
+            if (!own_ser_sigs->ser_preprepare_sig.has_value()) {
+                // only commits
+                serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+                ser->set_commit_multisig(own_ser_sigs->ser_commit_multisig.value(), own_ser_sigs->commits);
+                return ser;
+            }
+            else if (prepared() && commits.count() >= ::t + 1) {
+                // pre-prepare not necessary anymore (full round completed)
+                own_ser_sigs->ser_preprepare_sig.reset();
+            }
+        }
+        else if constexpr (PATT == GOSSIP) {
+            if (commits.count() == 3*::t + 1) {
+                serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+                ser->set_commit_multisig(own_ser_sigs->ser_commit_multisig.value(), own_ser_sigs->commits);
+                return ser;
+            }
+            else if (prepares.count() == 3*::t) {
+                serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+                ser->set_prepare_multisig(own_ser_sigs->ser_prepare_multisig.value(), own_ser_sigs->prepares);
+                if (own_ser_sigs->ser_commit_multisig.has_value()) {
+                    ser->set_commit_multisig(own_ser_sigs->ser_commit_multisig.value(), own_ser_sigs->commits);
+                }
+                return ser;
+            }
+        }
+        else if constexpr (GROUPED) {
+            serialized_pop_multi_signatures *ser = new serialized_pop_multi_signatures();
+            if (owner != head_of(owner)) {
+                // members only send their own signatures, to their head which has all the rest
+                if (group_commit_sig.has_value()) {
+                    ser->set_commit_multisig(serialized_sig(group_commit_sig.value()), group_commits);
+                }
+                else if (group_prepare_sig.has_value()) {
+                    ser->set_prepare_multisig(serialized_sig(group_prepare_sig.value()), group_prepares);
+                }
+                return ser;
+            }
+
+            if (committed()) {
+                ser->set_commit_multisig(own_ser_sigs->ser_commit_multisig.value(), own_ser_sigs->commits);
+                return ser;
+            }
+            if (prepared()) {
+                // the group had the pre-prepare from its head, the other heads from the leader
+                ser->set_prepare_multisig(own_ser_sigs->ser_prepare_multisig.value(), own_ser_sigs->prepares);
+            }
+            else if (own_ser_sigs->ser_preprepare_sig.has_value()) {
+                ser->add_preprepare(own_ser_sigs->ser_preprepare_sig.value());
+            }
+            if (forwarding) {
+                if (!prepared() && group_prepare_sig.has_value()) {
+                    ser->set_prepare_multisig(serialized_sig(group_prepare_sig.value()), group_prepares);
+                }
+                if (group_commit_sig.has_value()) {
+                    ser->set_commit_multisig(serialized_sig(group_commit_sig.value()), group_commits);
+                }
+                group_prepare_sig.reset();
+                group_prepares = bitmap();
+                group_commit_sig.reset();
+                group_commits = bitmap();
+                forwarding = false;
+            }
+            return ser;
+        }
+
+        return new serialized_pop_multi_signatures(*own_ser_sigs);
+    }
+
+    bool empty() {
+        return !preprepare_sig.has_value() && !prepare_multisig.has_value() && pending_prepares_sigs.empty() && !commit_multisig.has_value() && pending_commits_sigs.empty();
+    }
+};
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef SIGNATURES_H
 #define SIGNATURES_H
 
+#include <memory>
+#include <vector>
+
 #include "../serialized_signatures/serialized_signatures.h"
 #include "../signature.h"
 
@@ -8,8 +11,26 @@ class signatures {
 public:
     serialized_signatures *ser_sigs;
 
+    int owner = -1; // replica holding them, for payloads that depend on its role
+
+
+    // bytes ser_sigs may point into: own serializations and the storage of merged messages,
+    // kept alive for the messages that point into them in turn
+    std::vector<std::shared_ptr<uint8_t[]>> buffers;
+
     explicit signatures(serialized_signatures *ser_sigs) : ser_sigs(ser_sigs) {}
 
+    uint8_t * buffer(size_t size) {
+        buffers.push_back(std::make_shared<uint8_t[]>(size));
+        return buffers.back().get();
+    }
+
+    void keep(const std::shared_ptr<uint8_t[]> &storage) {
+        if (storage != nullptr) {
+            buffers.push_back(storage);
+        }
+    }
+
     virtual void add_preprepare(signature *) = 0;
 
     virtual void add_prepare(int, signature *) = 0;
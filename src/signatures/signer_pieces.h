@@ -0,0 +1,48 @@
+#ifndef SIGNER_PIECES_H
+#define SIGNER_PIECES_H
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "../bitmap.h"
+
+// every signer set received for one phase, with its aggregate (SIG), own signatures included: plain
+// aggregates only combine over disjoint sets, so a set overlapping the current one is kept and the
+// aggregate is re-packed from disjoint pieces whenever that covers more signers, instead of dropping it
+template <class SIG>
+class signer_pieces {
+public:
+    std::vector<bitmap> sets;
+    std::vector<SIG> sigs;
+
+    // worth verifying: a signer the current aggregate lacks, in a set not held yet (it may re-pack better)
+    bool adds(const bitmap &current, const bitmap &signers) const {
+        return !signers.empty() && !current.contains_all(signers) && std::find(sets.begin(), sets.end(), signers) == sets.end();
+    }
+
+    int add(const bitmap &signers, const SIG &sig) {
+        sets.push_back(signers);
+        sigs.push_back(sig);
+        return (int) sets.size() - 1;
+    }
+
+    // piece k, then greedily the largest pieces disjoint from what is packed so far
+    std::vector<int> pack(int k, bitmap &packed) const {
+        std::vector<int> order(sets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return sets.at(a).count() > sets.at(b).count(); });
+
+        std::vector<int> chosen {k};
+        packed = sets.at(k);
+        for (int j : order) {
+            if (j != k && !packed.intersects(sets.at(j))) {
+                chosen.push_back(j);
+                packed.merge(sets.at(j));
+            }
+        }
+        return chosen;
+    }
+};
+
+#endif
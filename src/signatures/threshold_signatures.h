@@ -11,7 +11,8 @@
 #include "signatures.h"
 #include "../serialized_signatures/serialized_threshold_signatures.h"
 
-class threshold_signatures : public signatures {
+template <int PATT>
+class threshold_signatures final : public signatures {
 public:
     std::optional<bls::InsecureSignature> preprepare_sig;
 
@@ -23,8 +24,12 @@ public:
 
     threshold_signatures() : signatures(new serialized_threshold_signatures()) {}
 
+    serialized_threshold_signatures * serialized() {
+        return static_cast<serialized_threshold_signatures *>(ser_sigs);
+    }
+
     void add_preprepare(signature *insec_sig) override {
-        bls::InsecureSignature sig = ((insecure_signature *) insec_sig)->sig;
+        bls::InsecureSignature sig = static_cast<insecure_signature *>(insec_sig)->sig;
 
         uint8_t *ser_sig = new uint8_t [bls::Signature::SIGNATURE_SIZE];
         sig.Serialize(ser_sig);
@@ -34,11 +39,11 @@ public:
 
     void set_preprepare(bls::InsecureSignature &sig, uint8_t *ser_sig) {
         preprepare_sig = bls::InsecureSignature(sig);
-        ((serialized_threshold_signatures *) ser_sigs)->add_preprepare(ser_sig);
+        serialized()->add_preprepare(ser_sig);
     }
 
     void add_prepare(int i, signature *insec_sig) override {
-        bls::InsecureSignature share = ((insecure_signature *) insec_sig)->sig;
+        bls::InsecureSignature share = static_cast<insecure_signature *>(insec_sig)->sig;
 
         prepare_shares.insert(std::pair<int, bls::InsecureSignature>(i, bls::InsecureSignature(share)));
 
@@ -49,18 +54,18 @@ public:
             uint8_t *ser_share = new uint8_t[bls::InsecureSignature::SIGNATURE_SIZE];
             share.Serialize(ser_share);
 
-            ((serialized_threshold_signatures *) ser_sigs)->add_prepare_share(i, ser_share);
+            serialized()->add_prepare_share(i, ser_share);
         }
     }
 
     void add_prepare(int i, bls::InsecureSignature &share, uint8_t *ser_share) {
         prepare_shares.insert(std::pair<int, bls::InsecureSignature>(i, bls::InsecureSignature(share)));
-        ((serialized_threshold_signatures *) ser_sigs)->add_prepare_share(i, ser_share);
+        serialized()->add_prepare_share(i, ser_share);
     }
 
     void set_prepare(bls::InsecureSignature &sig, uint8_t *ser_sig) {
         prepare_sig = bls::InsecureSignature(sig);
-        ((serialized_threshold_signatures *) ser_sigs)->add_prepare_sig(ser_sig);
+        serialized()->add_prepare_sig(ser_sig);
     }
 
     void create_prepare_sig() {
@@ -84,7 +89,7 @@ public:
     }
 
     void add_commit(int i, signature *insec_sig) override {
-        bls::InsecureSignature share = ((insecure_signature *) insec_sig)->sig;
+        bls::InsecureSignature share = static_cast<insecure_signature *>(insec_sig)->sig;
 
         commit_shares.insert(std::pair<int, bls::InsecureSignature>(i, bls::InsecureSignature(share)));
 
@@ -95,18 +100,18 @@ public:
             uint8_t *ser_share = new uint8_t[bls::InsecureSignature::SIGNATURE_SIZE];
             share.Serialize(ser_share);
 
-            ((serialized_threshold_signatures *) ser_sigs)->add_commit_share(i, ser_share);
+            serialized()->add_commit_share(i, ser_share);
         }
     }
 
     void add_commit(int i, bls::InsecureSignature &share, uint8_t *ser_share) {
         commit_shares.insert(std::pair<int, bls::InsecureSignature>(i, bls::InsecureSignature(share)));
-        ((serialized_threshold_signatures *) ser_sigs)->add_commit_share(i, ser_share);
+        serialized()->add_commit_share(i, ser_share);
     }
 
     void set_commit(bls::InsecureSignature &sig, uint8_t *ser_sig) {
         commit_sig = bls::InsecureSignature(sig);
-        ((serialized_threshold_signatures *) ser_sigs)->add_commit_sig(ser_sig);
+        serialized()->add_commit_sig(ser_sig);
     }
 
     void create_commit_sig() {
@@ -130,7 +135,7 @@ public:
     }
 
     void merge(threshold_signatures &sigs) {
-        serialized_threshold_signatures ser_sigs = *(serialized_threshold_signatures *) sigs.ser_sigs;
+        serialized_threshold_signatures ser_sigs = *sigs.serialized();
 
         if (sigs.preprepare_sig.has_value()) {
             set_preprepare(sigs.preprepare_sig.value(), ser_sigs.ser_preprepare_sig.value());
@@ -187,53 +192,53 @@ public:
 
     serialized_signatures * serialize() override {
         // /*
-        if (::patt == CENTRALIZED) {
+        if constexpr (PATT == CENTRALIZED) {
             if (committed()) {
                 serialized_threshold_signatures *ser = new serialized_threshold_signatures();
-                ser->set_commit_sig(((serialized_threshold_signatures *) ser_sigs)->ser_commit_sig.value());
+                ser->set_commit_sig(serialized()->ser_commit_sig.value());
                 return ser;
             }
             else if (prepared()) {
                 if (contains_commit(0)) {
                     serialized_threshold_signatures *ser = new serialized_threshold_signatures();
-                    ser->set_prepare_sig(((serialized_threshold_signatures *) ser_sigs)->ser_prepare_sig.value());
+                    ser->set_prepare_sig(serialized()->ser_prepare_sig.value());
                     return ser;
                 }
                 else {
                     serialized_threshold_signatures *ser = new serialized_threshold_signatures();
-                    ser->set_commit_shares(((serialized_threshold_signatures *) ser_sigs)->ser_commit_shares);
+                    ser->set_commit_shares(serialized()->ser_commit_shares);
                     return ser;
                 }
             }
             else {
                 if (prepare_shares.empty()) {
-                    return new serialized_threshold_signatures(*(serialized_threshold_signatures *) ser_sigs);
+                    return new serialized_threshold_signatures(*serialized());
                 }
                 else {
                     serialized_threshold_signatures *ser = new serialized_threshold_signatures();
-                    ser->set_prepare_shares(((serialized_threshold_signatures *) ser_sigs)->ser_prepare_shares);
+                    ser->set_prepare_shares(serialized()->ser_prepare_shares);
                     return ser;
                 }
             }
         }
-        else if (::patt == RING) {
-            if (!((serialized_threshold_signatures *) ser_sigs)->ser_preprepare_sig.has_value()) {
+        else if constexpr (PATT == RING || PATT == BIRING) {
+            if (!serialized()->ser_preprepare_sig.has_value()) {
                 // only commits
                 serialized_threshold_signatures *ser = new serialized_threshold_signatures();
-                ser->set_commit_sig(((serialized_threshold_signatures *) ser_sigs)->ser_commit_sig.value());
+                ser->set_commit_sig(serialized()->ser_commit_sig.value());
                 return ser;
             }
             else if (prepared() && (commit_shares.size() >= ::t + 1 || commit_sig.has_value())) {
                 // pre-prepare not necessary anymore (full round completed)
-                ((serialized_threshold_signatures *) ser_sigs)->ser_preprepare_sig.reset();
-                return new serialized_threshold_signatures(*(serialized_threshold_signatures *) ser_sigs);
+                serialized()->ser_preprepare_sig.reset();
+                return new serialized_threshold_signatures(*serialized());
             }
             else {
-                return new serialized_threshold_signatures(*(serialized_threshold_signatures *) ser_sigs);
+                return new serialized_threshold_signatures(*serialized());
             }
         }
         // */
-        return new serialized_threshold_signatures(*(serialized_threshold_signatures *) ser_sigs);
+        return new serialized_threshold_signatures(*serialized());
     }
 
     bool empty() {
@@ -1,58 +1,139 @@
 #ifndef LOG_H
 #define LOG_H
 
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include "arguments.h"
+#include "async/worker.h"
 #include "serialized_signatures/serialized_signatures.h"
 #include "signature.h"
-#include "signatures/signatures.h"
-#include "signatures/basic_signatures.h"
-#include "signatures/multi_signatures.h"
-#include "signatures/aggregate_signatures.h"
-#include "signatures/threshold_signatures.h"
-#include "signature_schemes/signature_scheme.h"
 #include "information.h"
+#include "timeline.h"
+
+// with -P the next instance's prepare and commit are signed while this one runs, the messages being the same
+// in every instance; by replica, and only where replicas outlive an instance (-mI and -mA, not the forked modes)
+class presigned_signatures {
+public:
+    std::mutex lock;
+    std::map<int, std::pair<std::shared_future<signature *>, std::shared_future<signature *>>> next;
+
+    static bool enabled() {
+        return ::instance + 1 < ::instances && (::mode == INPROCESS || ::mode == ASYNC);
+    }
+
+    // signed for replica i during the previous instance, or invalid futures
+    std::pair<std::shared_future<signature *>, std::shared_future<signature *>> take(int i) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = next.find(i);
+        if (it == next.end()) {
+            return {};
+        }
+        std::pair<std::shared_future<signature *>, std::shared_future<signature *>> sigs = it->second;
+        next.erase(it);
+        return sigs;
+    }
 
-signatures * createSignatures() {
-    switch (::scm) {
-        case BASICSIG:
-            return new basic_signatures();
-        case MULTISIG:
-            return new multi_signatures();
-        case AGGREGATESIG:
-            return new aggregate_signatures();
-        case THRESHOLDSIG:
-            return new threshold_signatures();
-        default:
-            return new basic_signatures();
+    void put(int i, std::shared_future<signature *> prepare, std::shared_future<signature *> commit) {
+        std::lock_guard<std::mutex> guard(lock);
+        next[i] = {prepare, commit};
     }
-}
+};
 
+presigned_signatures presigned;
+
+// SCHEME is a concrete (final) signature scheme, so signing, verification and the signatures
+// bookkeeping are resolved at compile time
+template <class SCHEME>
 class state_machine_replication {
 public:
+    using signatures_type = typename SCHEME::signatures_type;
+    using serialized_type = typename SCHEME::serialized_type;
+
     information info;
 
-    signature_scheme *scm;
+    SCHEME *scm;
 
-    signatures *sigs;
+    signatures_type *sigs;
 
-    explicit state_machine_replication(information &info, signature_scheme *scm) : info(info), scm(scm), sigs(createSignatures()) {}
+    // prepare and commit messages are known in advance, so with -P they are signed on the aggregation
+    // worker right away and only released once the protocol conditions hold
+    std::shared_future<signature *> speculative_prepare;
+    std::shared_future<signature *> speculative_commit;
+
+    explicit state_machine_replication(information &info, SCHEME *scm) : info(info), scm(scm), sigs(scm->create_signatures()) {
+        sigs->owner = info.i;
+        if (::presign) {
+            std::tie(speculative_prepare, speculative_commit) = ::presigned.take(info.i);
+            if (info.i != 0 && !speculative_prepare.valid()) {
+                speculative_prepare = speculate([scm] { return scm->sign_prepare(); });
+            }
+            if (!speculative_commit.valid()) {
+                speculative_commit = speculate([scm] { return scm->sign_commit(); });
+            }
+            if (presigned_signatures::enabled()) {
+                std::shared_future<signature *> next_prepare;
+                if (info.i != 0) {
+                    next_prepare = speculate([scm] { return scm->sign_prepare(); });
+                }
+                ::presigned.put(info.i, next_prepare, speculate([scm] { return scm->sign_commit(); }));
+            }
+        }
+    }
+
+    template <class SIGN>
+    static std::shared_future<signature *> speculate(SIGN sign) {
+        auto signed_ = std::make_shared<std::promise<signature *>>();
+        std::shared_future<signature *> sig = signed_->get_future().share();
+        aggregation_worker().post([signed_, sign] { signed_->set_value(sign()); });
+        return sig;
+    }
+
+    signature * sign_prepare() {
+        span s("sign", info.i);
+        return speculative_prepare.valid() ? speculative_prepare.get() : scm->sign_prepare();
+    }
+
+    signature * sign_commit() {
+        span s("sign", info.i);
+        return speculative_commit.valid() ? speculative_commit.get() : scm->sign_commit();
+    }
 
     void create_preprepare() {
-        signature *sig = scm->sign_preprepare();
+        signature *sig;
+        {
+            span s("sign", info.i);
+            sig = scm->sign_preprepare();
+        }
         sigs->add_preprepare(sig);
     };
 
+    bool verify(serialized_signatures *ser_sigs) {
+        span s("verify", info.i);
+        bool fresh = scm->verify(sigs, static_cast<serialized_type *>(ser_sigs)); // messages only carry the scheme's own type
+        if (fresh) {
+            sigs->keep(ser_sigs->storage); // what was merged may point into it
+        }
+        return fresh;
+    }
+
     bool receive(serialized_signatures *ser_sigs) {
-        if (!sigs->committed() && scm->verify(sigs, ser_sigs)) {
+        span s("receive", info.i);
+        if (!sigs->committed() && verify(ser_sigs)) {
             if (info.i != 0 && !sigs->contains_prepare(info.i)
                 && !sigs->prepared() // only creates if necessary
                     ) {
-                signature *sig = scm->sign_prepare();
+                signature *sig = sign_prepare();
                 sigs->add_prepare(info.i, sig);
             }
             if (sigs->prepared() && !sigs->contains_commit(info.i)
                 && !sigs->committed() // only creates if necessary
                     ) {
-                signature *sig = scm->sign_commit();
+                signature *sig = sign_commit();
                 sigs->add_commit(info.i, sig);
             }
             return true; // new stuff
@@ -61,6 +142,7 @@ public:
     }
 
     serialized_signatures * ser_sigs() {
+        span s("serialize", info.i);
         return sigs->serialize();
     }
 
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <vector>
+
+#include <bls.hpp>
+#include <privatekey.hpp>
+#include <publickey.hpp>
+#include <test-utils.hpp>
+
+#include "../arguments.h"
+#include "../signature_schemes/multi_signatures_scheme.h"
+
+// a multi-signature folded on the aggregation worker (-eB) with pk aggregation (-aP) has to verify at a
+// receiver like an eagerly aggregated one, both in process and after a round trip over the wire
+
+template <int EVAL>
+using scheme = multi_signatures_scheme<BROADCAST, EVAL, PKAGG, INDIVIDUAL>;
+
+template <int EVAL>
+std::vector<scheme<EVAL> *> create_schemes(int n) {
+    std::vector<bls::PrivateKey> sks;
+    std::vector<bls::PublicKey> pks;
+    for (int i = 0; i < n; i++) {
+        uint8_t seed[32];
+        getRandomSeed(seed);
+        sks.push_back(bls::PrivateKey::FromSeed(seed, sizeof(seed)));
+        pks.push_back(sks.at(i).GetPublicKey());
+    }
+    auto *prepared_pks = new prepared_keys(pks);
+    auto *agg_pks = new aggregated_public_keys(prepared_pks);
+
+    std::vector<scheme<EVAL> *> scms;
+    for (int i = 0; i < n; i++) {
+        scms.push_back(new scheme<EVAL>(sks.at(i), prepared_pks, agg_pks));
+    }
+    return scms;
+}
+
+// replica 0 collects every prepare and commit, replica 1 then verifies what replica 0 sends
+template <int EVAL>
+bool verifies(const char *name, bool over_wire) {
+    int n = 3*::t + 1;
+    std::vector<scheme<EVAL> *> scms = create_schemes<EVAL>(n);
+
+    auto *sigs = scms.at(0)->create_signatures();
+    sigs->add_preprepare(scms.at(0)->sign_preprepare());
+    for (int i = 1; i < n; i++) {
+        sigs->add_prepare(i, scms.at(i)->sign_prepare());
+    }
+    for (int i = 0; i < n; i++) {
+        sigs->add_commit(i, scms.at(i)->sign_commit());
+    }
+    serialized_signatures *ser_sigs = sigs->serialize();
+    if (over_wire) {
+        std::vector<uint8_t> buf;
+        ser_sigs->encode(buf);
+        ser_sigs = serialized_multi_signatures::decode(buf.data(), buf.size());
+    }
+
+    auto *rcvd_sigs = scms.at(1)->create_signatures();
+    bool ok = ser_sigs != nullptr && scms.at(1)->verify(rcvd_sigs, ser_sigs) && rcvd_sigs->prepared() && rcvd_sigs->committed();
+    std::cout << (ok ? "ok   " : "FAIL ") << name << (over_wire ? " over the wire" : "") << std::endl;
+    return ok;
+}
+
+int main() {
+    bls::BLS::Init();
+    ::t = 2;
+
+    bool ok = true;
+    for (bool over_wire : {false, true}) {
+        ok = verifies<EAGER>("eager pkagg", over_wire) && ok;
+        ok = verifies<LAZY>("lazy pkagg", over_wire) && ok;
+        ok = verifies<BACKGROUND>("background pkagg", over_wire) && ok;
+    }
+    return ok ? 0 : 1;
+}
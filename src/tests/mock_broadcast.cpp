@@ -0,0 +1,58 @@
+#include <iostream>
+#include <vector>
+
+#include <bls.hpp>
+
+#include "../arguments.h"
+#include "../launcher.h"
+#include "../pattern.h"
+#include "../signature_schemes/mock_signatures_scheme.h"
+#include "../transports/shm_transport.h"
+
+// broadcast delivers in any order once replicas run concurrently: every replica has to commit whichever
+// overlapping signer sets reach it first, on the coroutine pool and in forked processes alike
+
+using scheme = mock_signatures_scheme<BROADCAST, INDIVIDUAL>;
+
+std::vector<scheme *> create_schemes(int n) {
+    std::vector<scheme *> scms;
+    for (int i = 0; i < n; i++) {
+        scms.push_back(new scheme());
+    }
+    return scms;
+}
+
+bool commits(const char *name, int threads) {
+    int n = 3*::t + 1;
+    std::vector<scheme *> scms = create_schemes(n);
+
+    bool ok;
+    if (threads > 0) {
+        async_cluster<scheme, broadcast> cluster(scms, threads);
+        ok = cluster.launch();
+    }
+    else {
+        shm_network net(n, false);
+        ok = launch<scheme, broadcast>(scms, &net);
+    }
+    for (scheme *scm : scms) {
+        delete scm;
+    }
+
+    std::cout << name << " t=" << ::t << ": " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bls::BLS::Init();
+    ::mode = ASYNC;
+
+    bool ok = true;
+    for (int t : {1, 2, 3, 5}) {
+        ::t = t;
+        ok = commits("async, 1 thread", 1) && ok;
+        ok = commits("async, 4 threads", 4) && ok;
+        ok = commits("forked, shared memory", 0) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <vector>
+
+#include <bls.hpp>
+
+#include "../arguments.h"
+#include "../launcher.h"
+#include "../message.h"
+#include "../pattern.h"
+#include "../signature_schemes/mock_signatures_scheme.h"
+#include "../transports/shm_transport.h"
+
+// push-pull gossip has to bring every replica to commit where pushing to a fanout of 2 leaves some behind,
+// so it is run where plain gossip rarely commits them all; its stamps have to decode back, or be rejected
+
+using scheme = mock_signatures_scheme<GOSSIP, INDIVIDUAL>;
+
+bool commits(const char *name, int threads) {
+    int n = 3*::t + 1;
+    std::vector<scheme *> scms;
+    for (int i = 0; i < n; i++) {
+        scms.push_back(new scheme());
+    }
+
+    bool ok;
+    if (threads > 0) {
+        async_cluster<scheme, push_pull_gossip> cluster(scms, threads);
+        ok = cluster.launch();
+    }
+    else {
+        shm_network net(n, false);
+        ok = launch<scheme, push_pull_gossip>(scms, &net);
+    }
+    for (scheme *scm : scms) {
+        delete scm;
+    }
+
+    std::cout << name << " t=" << ::t << ": " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+bool stamps() {
+    int n = 3*::t + 1;
+    digest known {bitmap(n), bitmap(n)};
+    known.prepares.set(1);
+    known.commits.set(n - 1);
+
+    auto *ser = new serialized_mock_signatures();
+    ser->prepares = known.prepares;
+    message_ptr msg = message::encoded(ser, stamp {2, known});
+    std::vector<uint8_t> payload(msg->frame.begin() + 4, msg->frame.end());
+    message_ptr decoded = message::decoded<serialized_mock_signatures>(payload, true);
+    bool ok = decoded != nullptr && decoded->ser_sigs != nullptr && decoded->from->sender == 2
+            && decoded->from->known.covers(known) && known.covers(decoded->from->known);
+
+    message_ptr request = message::encoded(nullptr, stamp {3, known});
+    std::vector<uint8_t> alone(request->frame.begin() + 4, request->frame.end());
+    decoded = message::decoded<serialized_mock_signatures>(alone, true);
+    ok = ok && decoded != nullptr && decoded->ser_sigs == nullptr && decoded->from->sender == 3;
+
+    std::vector<uint8_t> sender = payload;
+    sender[0] = sender[1] = 0xff;
+    std::vector<uint8_t> truncated(payload.begin(), payload.begin() + 3);
+    alone.push_back(0);
+    ok = ok && message::decoded<serialized_mock_signatures>(sender, true) == nullptr
+            && message::decoded<serialized_mock_signatures>(truncated, true) == nullptr
+            && message::decoded<serialized_mock_signatures>(alone, true) == nullptr;
+
+    std::cout << "stamps t=" << ::t << ": " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+int main() {
+    bls::BLS::Init();
+    ::mode = ASYNC;
+    ::patt = GOSSIP;
+    ::f = 2;
+
+    bool ok = true;
+    for (int t : {1, 3, 10}) {
+        ::t = t;
+        ok = stamps() && ok;
+        ok = commits("async, 1 thread", 1) && ok;
+        ok = commits("async, 4 threads", 4) && ok;
+        ok = commits("forked, shared memory", 0) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// what each replica was doing and when (-J=<file>), as chrome trace events (chrome://tracing, perfetto):
+// one process per instance, one thread per replica, gaps are idle time waiting for messages
+class timeline_event {
+public:
+    const char *name;
+    int instance;
+    int replica;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+class timeline {
+public:
+    std::string path;
+    int instance = 0;
+    std::vector<int> sizes; // replicas of each instance
+    std::vector<timeline_event> events;
+    std::mutex lock; // replicas of -mA record from the pool threads
+
+    bool enabled() const {
+        return !path.empty();
+    }
+
+    void begin(int k, int n) {
+        std::lock_guard<std::mutex> guard(lock);
+        instance = k;
+        sizes.resize(k + 1, 0);
+        sizes.at(k) = n;
+    }
+
+    void add(const char *name, int replica, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        std::lock_guard<std::mutex> guard(lock);
+        events.push_back({name, instance, replica, start, end});
+    }
+
+    // steady clock microseconds, shared by the processes of -mS, -mM and -mB so their files line up
+    static double micros(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time.time_since_epoch()).count();
+    }
+
+    bool write(const std::string &file) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::ofstream out(file);
+        if (!out) {
+            return false;
+        }
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (int k = 0; k < (int) sizes.size(); k++) {
+            out << (first ? "" : ",") << "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << k << ",\"args\":{\"name\":\"instance " << k << "\"}}";
+            first = false;
+            for (int i = 0; i < sizes.at(k); i++) {
+                out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << k << ",\"tid\":" << i << ",\"args\":{\"name\":\"replica " << i << "\"}}";
+            }
+        }
+        out.precision(3);
+        out << std::fixed;
+        for (const timeline_event &event : events) {
+            out << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << event.instance << ",\"tid\":" << event.replica
+                << ",\"ts\":" << micros(event.start) << ",\"dur\":" << micros(event.end) - micros(event.start) << "}";
+            first = false;
+        }
+        out << "\n]}\n";
+        return (bool) out;
+    }
+};
+
+timeline activity;
+
+// scoped activity of a replica, recorded when it ends
+class span {
+public:
+    const char *name;
+    int replica;
+    bool on;
+    std::chrono::steady_clock::time_point start;
+
+    span(const char *name, int replica) : name(name), replica(replica), on(::activity.enabled()) {
+        if (on) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~span() {
+        if (on) {
+            ::activity.add(name, replica, start, std::chrono::steady_clock::now());
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// binary trace of in-process runs (-T=<file>), replayed against other link models without crypto:
+// an 8-byte magic, then per instance a header record (kind 0, u16 n) followed by one record per replica
+// step (kind 1), little-endian:
+//   u64 time (ns since the instance started), u64 cpu (ns of receive, verify, sign and serialize),
+//   u16 replica, i32 trigger (step whose message was handled, -1 for the leader's start),
+//   u8 state (after the step), u32 bytes (of the sent message), u16 count, count x u16 destinations
+// steps are numbered from 0 in each instance, in the order they ran
+class trace_step {
+public:
+    static const uint8_t OWN_PREPARE = 1;
+    static const uint8_t OWN_COMMIT = 2;
+    static const uint8_t PREPARED = 4;
+    static const uint8_t COMMITTED = 8;
+
+    uint64_t time = 0;
+    uint64_t cpu = 0;
+    int replica = 0;
+    int trigger = -1;
+    uint8_t state = 0;
+    uint32_t bytes = 0;
+    std::vector<int> dests;
+};
+
+class trace_writer {
+public:
+    static constexpr char MAGIC[8] = {'B', 'F', 'T', 'T', 'R', 'A', 'C', 'E'};
+    static const size_t FLUSH = 1 << 16;
+
+    std::ofstream out;
+    std::vector<uint8_t> buf;
+    int steps = 0;
+
+    bool open(const std::string &path) {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(MAGIC, sizeof(MAGIC));
+        return true;
+    }
+
+    bool enabled() const {
+        return out.is_open();
+    }
+
+    void put(uint64_t value, int bytes) {
+        for (int b = 0; b < bytes; b++) {
+            buf.push_back((value >> (8 * b)) & 0xff);
+        }
+    }
+
+    void instance(int n) {
+        put(0, 1);
+        put(n, 2);
+        steps = 0;
+    }
+
+    // returns the number of the step, what its message is later handled as
+    int step(const trace_step &s) {
+        put(1, 1);
+        put(s.time, 8);
+        put(s.cpu, 8);
+        put(s.replica, 2);
+        put((uint32_t) s.trigger, 4);
+        put(s.state, 1);
+        put(s.bytes, 4);
+        put(s.dests.size(), 2);
+        for (int dest : s.dests) {
+            put(dest, 2);
+        }
+        if (buf.size() >= FLUSH) {
+            flush();
+        }
+        return steps++;
+    }
+
+    void flush() {
+        out.write((const char *) buf.data(), (std::streamsize) buf.size());
+        out.flush();
+        buf.clear();
+    }
+};
+
+// reads back what trace_writer wrote, record by record
+class trace_reader {
+public:
+    std::ifstream in;
+
+    bool open(const std::string &path) {
+        in.open(path, std::ios::binary);
+        char magic[sizeof(trace_writer::MAGIC)];
+        return in.read(magic, sizeof(magic)) && std::memcmp(magic, trace_writer::MAGIC, sizeof(magic)) == 0;
+    }
+
+    uint64_t get(int bytes) {
+        uint64_t value = 0;
+        for (int b = 0; b < bytes; b++) {
+            value |= (uint64_t) (uint8_t) in.get() << (8 * b);
+        }
+        return value;
+    }
+
+    // false at the end of the trace; n is set by header records, s by steps
+    bool next(bool &header, int &n, trace_step &s) {
+        int kind = in.get();
+        if (kind == EOF) {
+            return false;
+        }
+        header = kind == 0;
+        if (header) {
+            n = (int) get(2);
+            return (bool) in;
+        }
+        s.time = get(8);
+        s.cpu = get(8);
+        s.replica = (int) get(2);
+        s.trigger = (int32_t) get(4);
+        s.state = (uint8_t) get(1);
+        s.bytes = (uint32_t) get(4);
+        s.dests.resize(get(2));
+        for (int &dest : s.dests) {
+            dest = (int) get(2);
+        }
+        return (bool) in;
+    }
+};
+
+trace_writer tracer;
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "transport.h"
+
+#define RING_CAPACITY (1 << 18) // bytes per ordered pair of replicas
+
+// lock-free single-producer/single-consumer byte stream of frames; head and tail only grow, so
+// head - tail is the number of unread bytes
+class shm_ring {
+public:
+    alignas(64) std::atomic<uint64_t> head; // bytes written, producer only
+    alignas(64) std::atomic<uint64_t> tail; // bytes read, consumer only
+    alignas(64) std::atomic<uint32_t> blocked; // producer has bytes that did not fit
+
+    uint8_t * data() {
+        return (uint8_t *) this + sizeof(shm_ring);
+    }
+
+    size_t write(const uint8_t *bytes, size_t size) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        size_t count = std::min<size_t>(size, RING_CAPACITY - (h - t));
+        size_t offset = h % RING_CAPACITY;
+        size_t first = std::min<size_t>(count, RING_CAPACITY - offset);
+        std::memcpy(data() + offset, bytes, first);
+        std::memcpy(data(), bytes + first, count - first);
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t read(std::vector<uint8_t> &into) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        size_t count = h - t;
+        size_t offset = t % RING_CAPACITY;
+        size_t first = std::min<size_t>(count, RING_CAPACITY - offset);
+        into.insert(into.end(), data() + offset, data() + offset + first);
+        into.insert(into.end(), data(), data() + count - first);
+        tail.store(h, std::memory_order_release);
+        return count;
+    }
+};
+
+// one per replica: producers bump seq after writing to any of its rings, and only pay for a
+// futex wake when the replica is asleep on it
+class shm_bell {
+public:
+    alignas(64) std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> sleeping;
+    std::atomic<uint32_t> closed; // replica exited, drop what is queued for it
+};
+
+class shm_transport : public transport {
+public:
+    int i;
+    int n;
+    bool busy_poll;
+    shm_bell *bells;
+    uint8_t *rings;
+
+    std::vector<std::vector<uint8_t>> in; // by source, bytes of incomplete frames
+    std::vector<std::deque<message_ptr>> out; // by destination, messages that did not fit in the ring yet
+    std::vector<size_t> out_pos; // by destination, bytes of the front frame already written
+
+    shm_transport(int i, int n, bool busy_poll, shm_bell *bells, uint8_t *rings) :
+            i(i), n(n), busy_poll(busy_poll), bells(bells), rings(rings), in(n), out(n), out_pos(n, 0) {}
+
+    ~shm_transport() override {
+        bells[i].closed.store(1);
+    }
+
+    static size_t stride() {
+        return sizeof(shm_ring) + RING_CAPACITY;
+    }
+
+    shm_ring * ring(int src, int dst) {
+        return (shm_ring *) (rings + (src * n + dst) * stride());
+    }
+
+    void ring_bell(int j) {
+        bells[j].seq.fetch_add(1);
+        if (bells[j].sleeping.load()) {
+            syscall(SYS_futex, (uint32_t *) &bells[j].seq, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    // true if anything moved
+    bool write_pending(int dest) {
+        if (bells[dest].closed.load()) {
+            out[dest].clear();
+            out_pos[dest] = 0;
+            return false;
+        }
+        shm_ring *r = ring(i, dest);
+        bool moved = false;
+        while (!out[dest].empty()) {
+            const std::vector<uint8_t> &frame = out[dest].front()->frame;
+            size_t written = r->write(frame.data() + out_pos[dest], frame.size() - out_pos[dest]);
+            moved = moved || written > 0;
+            out_pos[dest] += written;
+            if (out_pos[dest] < frame.size()) {
+                break;
+            }
+            out[dest].pop_front();
+            out_pos[dest] = 0;
+        }
+        r->blocked.store(!out[dest].empty());
+        if (moved) {
+            ring_bell(dest);
+        }
+        return moved;
+    }
+
+    bool read_frames(int src, std::vector<std::vector<uint8_t>> &payloads) {
+        shm_ring *r = ring(src, i);
+        if (r->read(in[src]) == 0) {
+            return false;
+        }
+        if (r->blocked.load()) {
+            ring_bell(src);
+        }
+        if (!take_frames(in[src], payloads)) {
+            in[src].clear();
+        }
+        return true;
+    }
+
+    void send(int dest, const message_ptr &msg) override {
+        sent += msg->length;
+        out[dest].push_back(msg);
+        write_pending(dest);
+    }
+
+    bool receive(int timeout, std::vector<std::vector<uint8_t>> &payloads) override {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        while (true) {
+            uint32_t seq = bells[i].seq.load();
+
+            bool progress = false;
+            for (int j = 0; j < n; j++) {
+                if (j != i && !out[j].empty()) {
+                    progress = write_pending(j) || progress;
+                }
+            }
+            for (int j = 0; j < n; j++) {
+                if (j != i) {
+                    progress = read_frames(j, payloads) || progress;
+                }
+            }
+            if (progress) {
+                return true;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+            if (!busy_poll) {
+                auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+                timespec ts{(time_t) (remaining / 1000000000), (long) (remaining % 1000000000)};
+                bells[i].sleeping.store(1);
+                syscall(SYS_futex, (uint32_t *) &bells[i].seq, FUTEX_WAIT, seq, &ts, nullptr, 0);
+                bells[i].sleeping.store(0);
+            }
+        }
+    }
+
+    void flush(int timeout) override {
+        std::vector<std::vector<uint8_t>> ignored;
+        while (true) {
+            bool pending = false;
+            for (int j = 0; j < n; j++) {
+                pending = pending || (!out[j].empty() && !bells[j].closed.load());
+            }
+            if (!pending || !receive(timeout, ignored)) {
+                return;
+            }
+            ignored.clear();
+        }
+    }
+};
+
+// bells and the n*n rings (indexed src*n + dst) live in one shared anonymous mapping made before forking;
+// pages of rings that are never used are never touched
+class shm_network : public network {
+public:
+    int n;
+    bool busy_poll;
+    size_t size;
+    uint8_t *region;
+
+    shm_network(int n, bool busy_poll) : n(n), busy_poll(busy_poll) {
+        size = n * sizeof(shm_bell) + (size_t) n * n * shm_transport::stride();
+        void *mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        region = mapped == MAP_FAILED ? nullptr : (uint8_t *) mapped;
+        if (region != nullptr) {
+            for (int j = 0; j < n; j++) {
+                new (bells() + j) shm_bell();
+            }
+            for (int k = 0; k < n * n; k++) {
+                new (rings() + k * shm_transport::stride()) shm_ring();
+            }
+        }
+    }
+
+    ~shm_network() override {
+        if (region != nullptr) {
+            munmap(region, size);
+        }
+    }
+
+    shm_bell * bells() {
+        return (shm_bell *) region;
+    }
+
+    uint8_t * rings() {
+        return region + n * sizeof(shm_bell);
+    }
+
+    bool ready() override {
+        return region != nullptr;
+    }
+
+    transport * endpoint(int i) override {
+        return new shm_transport(i, n, busy_poll, bells(), rings());
+    }
+};
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef TCP_TRANSPORT_H
+#define TCP_TRANSPORT_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "transport.h"
+
+class tcp_connection {
+public:
+    int fd;
+    int peer; // destination of an outgoing connection, -1 if accepted
+
+    std::vector<uint8_t> in; // bytes of incomplete frames
+    std::deque<message_ptr> out; // queued messages
+    size_t out_pos = 0; // bytes of the front frame already sent
+
+    tcp_connection(int fd, int peer) : fd(fd), peer(peer) {}
+
+    bool pending() const {
+        return !out.empty();
+    }
+
+    void sent(size_t count) {
+        while (count > 0) {
+            size_t rest = out.front()->frame.size() - out_pos;
+            if (count < rest) {
+                out_pos += count;
+                return;
+            }
+            count -= rest;
+            out.pop_front();
+            out_pos = 0;
+        }
+    }
+};
+
+// replica i listens on 127.0.0.1:port+i; frames go over one connection per ordered pair of replicas,
+// driven by a non-blocking epoll loop
+class tcp_transport : public transport {
+public:
+    int i;
+    int port;
+    int listener;
+    int epoll_fd;
+
+    std::map<int, tcp_connection> connections; // by fd
+    std::map<int, int> outgoing; // destination -> fd
+    std::set<int> signed_off; // peers that committed and exited, nothing is sent to them anymore
+
+    static constexpr uint8_t SIGN_OFF = 1; // the only byte ever written back on an accepted connection
+
+    tcp_transport(int i, int listener, int port) : i(i), port(port), listener(listener) {
+        epoll_fd = epoll_create1(0);
+        watch(listener, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    ~tcp_transport() override {
+        for (std::pair<const int, tcp_connection> &pair : connections) {
+            close(pair.first);
+        }
+        close(listener);
+        close(epoll_fd);
+    }
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, op, fd, &event);
+    }
+
+    int connect_to(int dest) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port + dest);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+
+        connections.emplace(fd, tcp_connection(fd, dest));
+        outgoing[dest] = fd;
+        watch(fd, EPOLLIN | EPOLLOUT, EPOLL_CTL_ADD);
+        return fd;
+    }
+
+    // whether the peer of an outgoing connection signed off, read from what it wrote back (a sign-off
+    // written before it closed stays readable after a reset)
+    bool peer_signed_off(tcp_connection &conn) {
+        uint8_t byte;
+        ssize_t rcvd;
+        while ((rcvd = recv(conn.fd, &byte, 1, 0)) < 0 && errno == EINTR) {}
+        if (rcvd == 1 && byte == SIGN_OFF) {
+            signed_off.insert(conn.peer);
+        }
+        return signed_off.count(conn.peer) > 0;
+    }
+
+    // what was queued for a peer is gone with its connection, the peer may then never commit; not reported
+    // once the peer signed off, as it had committed, nor when it refused the connection: its listener, bound
+    // before the fork, is only closed once its process exited, and launch reports how it did
+    void lost(tcp_connection &conn, int error, const char *reason = nullptr) {
+        if (error != ECONNREFUSED && !peer_signed_off(conn)) {
+            lost(conn.peer, conn.out.size(), reason != nullptr ? reason : error != 0 ? std::strerror(error) : "hung up");
+        }
+    }
+
+    void lost(int dest, size_t queued, const char *reason) {
+        std::cerr << "replica " << i << ": connection to " << dest << " failed (" << reason << "), " << queued << " messages lost" << std::endl;
+    }
+
+    void drop(int fd) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) {
+            return;
+        }
+        if (it->second.peer >= 0) {
+            outgoing.erase(it->second.peer);
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(it);
+    }
+
+    // false if the connection was dropped
+    bool write_pending(tcp_connection &conn) {
+        while (conn.pending()) {
+            // gather the queued frames, which are shared with the other destinations
+            iovec iov[64];
+            int count = 0;
+            size_t pos = conn.out_pos;
+            for (auto it = conn.out.begin(); it != conn.out.end() && count < 64; it++) {
+                const std::vector<uint8_t> &frame = (*it)->frame;
+                iov[count].iov_base = (void *) (frame.data() + pos);
+                iov[count].iov_len = frame.size() - pos;
+                count++;
+                pos = 0;
+            }
+            msghdr hdr{};
+            hdr.msg_iov = iov;
+            hdr.msg_iovlen = count;
+
+            ssize_t sent = sendmsg(conn.fd, &hdr, MSG_NOSIGNAL);
+            if (sent > 0) {
+                conn.sent(sent);
+            }
+            else if (sent == 0) {
+                // nothing taken from non-empty frames, errno is stale
+                lost(conn, 0, "sendmsg sent nothing");
+                drop(conn.fd);
+                return false;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOTCONN) {
+                watch(conn.fd, EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+                return true;
+            }
+            else if (errno != EINTR) {
+                lost(conn, errno);
+                drop(conn.fd);
+                return false;
+            }
+        }
+        watch(conn.fd, EPOLLIN, EPOLL_CTL_MOD);
+        return true;
+    }
+
+    void send(int dest, const message_ptr &msg) override {
+        if (signed_off.count(dest) > 0) {
+            return;
+        }
+        auto it = outgoing.find(dest);
+        int fd = it != outgoing.end() ? it->second : connect_to(dest);
+        if (fd < 0) {
+            lost(dest, 1, std::strerror(errno));
+            return;
+        }
+
+        tcp_connection &conn = connections.at(fd);
+        sent += msg->length;
+        conn.out.push_back(msg);
+        write_pending(conn);
+    }
+
+    void accept_all() {
+        int fd;
+        while ((fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+            connections.emplace(fd, tcp_connection(fd, -1));
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+    }
+
+    void read_frames(tcp_connection &conn, std::vector<std::vector<uint8_t>> &payloads) {
+        bool closed = false;
+        uint8_t chunk[1 << 16];
+        while (true) {
+            ssize_t rcvd = recv(conn.fd, chunk, sizeof(chunk), 0);
+            if (rcvd > 0) {
+                conn.in.insert(conn.in.end(), chunk, chunk + rcvd);
+            }
+            else if (rcvd < 0 && errno == EINTR) {
+                continue;
+            }
+            else {
+                closed = rcvd == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                break;
+            }
+        }
+
+        if (!take_frames(conn.in, payloads)) {
+            drop(conn.fd);
+            return;
+        }
+
+        if (closed) {
+            drop(conn.fd);
+        }
+    }
+
+    bool receive(int timeout, std::vector<std::vector<uint8_t>> &payloads) override {
+        epoll_event events[64];
+        int count = epoll_wait(epoll_fd, events, 64, timeout);
+        if (count < 0) {
+            return errno == EINTR;
+        }
+        if (count == 0) {
+            return false;
+        }
+
+        for (int k = 0; k < count; k++) {
+            int fd = events[k].data.fd;
+            if (fd == listener) {
+                accept_all();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            tcp_connection &conn = it->second;
+            if (conn.peer >= 0) {
+                if (events[k].events & (EPOLLERR | EPOLLHUP | EPOLLIN)) {
+                    // the peer signed off or closed, or e.g. refused the connect
+                    int error = 0;
+                    socklen_t length = sizeof(error);
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                    if (conn.pending()) {
+                        lost(conn, error);
+                    }
+                    else {
+                        peer_signed_off(conn);
+                    }
+                    drop(fd);
+                }
+                else {
+                    write_pending(conn);
+                }
+            }
+            else {
+                read_frames(conn, payloads);
+            }
+        }
+        return true;
+    }
+
+    // written on every accepted connection, whose peer reads it on its outgoing one
+    void sign_off() override {
+        for (std::pair<const int, tcp_connection> &pair : connections) {
+            if (pair.second.peer < 0) {
+                ::send(pair.first, &SIGN_OFF, 1, MSG_NOSIGNAL);
+            }
+        }
+    }
+
+    void flush(int timeout) override {
+        std::vector<std::vector<uint8_t>> ignored;
+        while (true) {
+            bool pending = false;
+            for (std::pair<const int, tcp_connection> &pair : connections) {
+                pending = pending || pair.second.pending();
+            }
+            if (!pending || !receive(timeout, ignored)) {
+                return;
+            }
+            ignored.clear();
+        }
+    }
+};
+
+class tcp_network : public network {
+public:
+    int port;
+    std::vector<int> listeners;
+
+    // listening sockets are bound before forking, so no replica can connect to a peer that is not listening yet
+    tcp_network(int n, int port) : port(port) {
+        for (int i = 0; i < n; i++) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port + i);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (fd >= 0 && (bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, n) < 0)) {
+                close(fd);
+                fd = -1;
+            }
+            listeners.push_back(fd);
+        }
+    }
+
+    ~tcp_network() override {
+        for (int fd : listeners) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bool ready() override {
+        for (int fd : listeners) {
+            if (fd < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    transport * endpoint(int i) override {
+        for (int j = 0; j < (int) listeners.size(); j++) {
+            if (j != i) {
+                close(listeners.at(j));
+            }
+        }
+        int listener = listeners.at(i);
+        listeners.clear();
+        return new tcp_transport(i, listener, port);
+    }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../message.h"
+
+#define MAX_FRAME (64 << 20)
+
+// a replica's end of the network; payloads are whole encoded serialized signatures, framed by a
+// 4-byte little-endian length (see message::encoded)
+class transport {
+public:
+    long sent = 0; // bytes queued by send, as counted in-process (see message::length)
+
+    // moves the complete frames at the front of in to payloads, false on an oversized frame
+    static bool take_frames(std::vector<uint8_t> &in, std::vector<std::vector<uint8_t>> &payloads) {
+        size_t pos = 0;
+        while (in.size() - pos >= 4) {
+            uint32_t size = in[pos] | (in[pos + 1] << 8) | (in[pos + 2] << 16) | ((uint32_t) in[pos + 3] << 24);
+            if (size > MAX_FRAME) {
+                return false;
+            }
+            if (in.size() - pos - 4 < size) {
+                break;
+            }
+            payloads.emplace_back(in.begin() + pos + 4, in.begin() + pos + 4 + size);
+            pos += 4 + size;
+        }
+        in.erase(in.begin(), in.begin() + pos);
+        return true;
+    }
+
+    // queues the shared frame of msg, which is not copied
+    virtual void send(int dest, const message_ptr &msg) = 0;
+
+    // appends the payloads received within timeout (ms), false if nothing happened in that time
+    virtual bool receive(int timeout, std::vector<std::vector<uint8_t>> &payloads) = 0;
+
+    // pushes out what is still queued before the replica exits
+    virtual void flush(int timeout) = 0;
+
+    // the replica committed and exits: what its peers still send it is not missed
+    virtual void sign_off() {}
+
+    virtual ~transport() = default;
+};
+
+// set up once before the replicas are forked; endpoint(i) is then called in replica i's process
+class network {
+public:
+    virtual bool ready() = 0;
+
+    virtual transport * endpoint(int i) = 0;
+
+    virtual ~network() = default;
+};
+
+#endif